@@ -1,14 +1,27 @@
 #ifndef CORE_ALL_H
 #define CORE_ALL_H
 
+#include "app.h"
 #include "base.h"
+#include "crash.h"
 #include "cstring.h"
+#include "flatmap.h"
+#include "frame.h"
+#include "heap.h"
 #include "input.h"
+#include "intern.h"
 #include "list.h"
 #include "log.h"
+#include "logsink.h"
 #include "memory.h"
+#include "profile.h"
+#include "sort.h"
 #include "stack.h"
+#include "strview.h"
+#include "thread.h"
 #include "timer.h"
+#include "timerwheel.h"
+#include "trace.h"
 #include "vector.h"
 
 #endif /* CORE_ALL_H */
@@ -0,0 +1,126 @@
+/**
+ * app.h
+ *
+ * @brief The application loop: fixed timestep updates, interpolated rendering
+ *
+ * Every frame app_run waits for the frame limiter, polls input, runs as many
+ * fixed steps of update as the elapsed time calls for and renders once with
+ * alpha, how far the simulation is into the next step (0..1), to interpolate
+ * between the last two states with.
+ *
+ * When a frame takes so long that more than max_updates steps are due, the
+ * rest are dropped rather than making the next frame even longer.
+ *
+ * The limiter sleeps for most of the wait and spins for the last part, how
+ * long it spins follows how late the OS has been waking it up recently.
+ *
+ * With a WINDOW_HEADLESS window the loop runs on the window's virtual clock
+ * and never waits, every frame is one frame period (1/60 s without a limit)
+ * apart however long it really took.
+ *
+ * An event_driven app instead sleeps in input_wait_events until there's input,
+ * a timer of app->timers is due or another thread calls app_wake or app_redraw.
+ * Every wake-up runs update once, with dt the time since the last one, and only
+ * renders, with alpha 1, when something marked the app dirty: any input does,
+ * and app_redraw, e.g. from an update or a timer whose change shows. A frame
+ * rate limit then spaces the redraws rather than pacing the loop. Headless, it
+ * never sleeps and flips every time round, to keep the virtual clock going.
+ *
+ * With render_thread, render and window_flip run on a thread of their own,
+ * which takes the window's GL context, while app_run's thread keeps pumping
+ * events and updating. Once a frame's updates are done, submit copies what
+ * render needs into one of two frame packets of packet_size bytes, and the
+ * render thread draws the latest one, found in app->packet, while the next is
+ * being simulated. The simulation is at most one frame ahead, it waits for the
+ * render thread to take the last packet before it starts another. render must
+ * then read nothing but the packet, and only the render thread may call into
+ * frame.h. A headless window ignores render_thread, its clock moves with the
+ * loop. Without render_thread the packet, if any, is filled and drawn inline.
+ *
+ * Input is polled once per frame and latched: the first update after a poll
+ * sees every press, release and scroll since the last update ran, later updates
+ * of the same frame see none, and a frame that runs no update keeps them for
+ * the next one. What's held down is always that of the last poll.
+ *
+ * NOTE: Window resizes and exposes aren't input, an event_driven app that needs
+ *       to repaint on them calls app_redraw itself
+ */
+
+#ifndef CORE_APP_H
+#define CORE_APP_H
+
+#include "engine/core/input.h"
+#include "engine/core/timerwheel.h"
+#include "engine/graphics/window.h"
+
+#include <stdint.h>
+
+typedef struct app_t app_t;
+
+typedef struct app__renderer_t app__renderer_t;
+
+typedef struct app_props_t
+{
+    window_props_t window;
+
+    double   update_hz;     /* Simulation rate, 0 for 60 */
+    double   fps;           /* Frame rate limit, 0 for none (e.g. with vsync) */
+    unsigned max_updates;   /* Most steps run in one frame to catch up, 0 for 5 */
+
+    void   (*update)(app_t* app, double dt);        /* dt is the fixed step in seconds, the time since the last update when event_driven */
+    void   (*render)(app_t* app, double alpha);
+    void*    user;
+
+    bool     event_driven;  /* Sleeps until there's something to do, see above */
+
+    bool     render_thread; /* Renders on a thread of its own, see above */
+    size_t   packet_size;   /* Bytes of each frame packet, 0 for none */
+    void   (*submit)(app_t* app, void* packet, double alpha);  /* Fills a packet, on app_run's thread */
+} app_props_t;
+
+struct app_t
+{
+    window_t*     window;
+    input_t*      input;
+    timerwheel_t* timers;   /* On window_time, advanced every time round the loop */
+    void*         user;
+
+    void    (*update)(app_t* app, double dt);
+    void    (*render)(app_t* app, double alpha);
+    void    (*submit)(app_t* app, void* packet, double alpha);
+
+    size_t           packet_size;
+    void*            packets[2];    /* The second only with a render thread */
+    const void*      packet;        /* The one render is drawing */
+    app__renderer_t* renderer;      /* NULL without a render thread */
+
+    uint64_t  step;         /* ns */
+    uint64_t  period;       /* ns, 0 without a limit */
+    unsigned  max_updates;
+
+    uint64_t  ticks;        /* Updates run so far */
+    uint64_t  dropped;      /* Updates skipped by the catch-up cap */
+    double    alpha;
+    uint64_t  slack;        /* How long before a deadline the limiter stops sleeping */
+    int       redraw;       /* Atomic, set when an event_driven app is dirty */
+    bool      event_driven;
+    bool      running;      /* Atomic, app_quit may come from the render thread */
+};
+
+app_t*  app_create(const app_props_t* props);
+void    app_destroy(app_t* app);
+
+/** Runs until the window is closed or app_quit is called */
+void    app_run(app_t* app);
+
+/** Stops app_run after the current frame, can be called from any thread */
+void    app_quit(app_t* app);
+
+/** Wakes an event_driven app, app_redraw also has it render. Both can be called from any thread */
+void    app_wake(app_t* app);
+void    app_redraw(app_t* app);
+
+/** Changes the frame rate limit, 0 removes it */
+void    app_set_fps(app_t* app, double fps);
+
+#endif /* CORE_APP_H */
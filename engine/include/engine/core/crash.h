@@ -0,0 +1,35 @@
+/**
+ * crash.h
+ *
+ * @brief Writes a crash report when the process dies from a fatal signal
+ *
+ * On SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT and SIGTRAP (which log_fatal and
+ * log_assert raise) the handler writes the signal, a symbolized backtrace, the
+ * log messages that hadn't been written yet, the last lines of a ring sink and
+ * the memory tracker's counters, both to the crash file and to stderr. The
+ * signal is then re-raised with its default action, so core dumps and exit
+ * codes are unchanged.
+ *
+ * The handler only makes async-signal-safe calls, with the usual exception of
+ * backtrace_symbols_fd. It runs on its own stack so stack overflows get reported.
+ * That stack is per thread: crash_init sets it up for its own thread, any other
+ * thread that may overflow calls crash_thread_init first.
+ *
+ * NOTE: Backtraces need glibc (or macOS), and function names need the
+ *       executable to be linked with -rdynamic
+ */
+
+#ifndef CORE_CRASH_H
+#define CORE_CRASH_H
+
+#include "engine/core/log.h"
+
+/** ring may be NULL, otherwise a sink from logsink_ring_create */
+bool crash_init(const char* path, log_sink_t* ring);
+void crash_shutdown(void);
+
+/** Gives the calling thread a stack to report its overflows on, crash_thread_shutdown frees it before the thread exits */
+bool crash_thread_init(void);
+void crash_thread_shutdown(void);
+
+#endif /* CORE_CRASH_H */
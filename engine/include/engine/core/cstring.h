@@ -1,8 +1,17 @@
 /**
- * dstring.h
+ * cstring.h
  *
  * A convinient wrapper around a char vector and includes some extra functionality
  *
+ * The vector always holds a null terminator after the last character, so its
+ * size is string_len + 1. Functions that can grow the string take a string_t*
+ * since growing may move it.
+ *
+ * strbuf_t is a string builder for text that is formatted over and over, e.g.
+ * debug overlays. Short strings live inside the struct itself, so building
+ * one doesn't allocate until it outgrows STRBUF_SMALL bytes, and clearing it
+ * keeps its capacity so it stops allocating once it has warmed up.
+ *
  * NOTE: A string_t type can be passed in wherever there is a char* parameter,
  *          but a char* cannot be passed to a string_t parameter
  */
@@ -12,32 +21,118 @@
 
 #include "engine/core/base.h"
 
+#include <stdarg.h>
+
 typedef char* string_t;
 
 string_t    string_create(const char* c_str);
+string_t    string_create_n(const char* c_str, size_t len);
 void        string_destroy(string_t str);
 
 size_t      string_len(const string_t str);
+size_t      string_capacity(const string_t str);
+
+/** Makes room for at least len characters so appending up to that doesn't allocate */
+void        string_reserve(string_t* str, size_t len);
+void        string_clear(string_t str);
 
-void        string_cat(string_t str1, const string_t str2);
-void        string_catc(string_t str1, const char* str2);
-void        string_push(string_t str, char c);
-void        string_copy(string_t dest, const string_t src);
+void        string_cat(string_t* str1, const string_t str2);
+void        string_catc(string_t* str1, const char* str2);
+void        string_catn(string_t* str1, const char* str2, size_t len);
+void        string_push(string_t* str, char c);
+void        string_copy(string_t* dest, const string_t src);
 int         string_cmp(const string_t str1, const string_t str2);
 
 char*       string_find(const string_t big, const string_t little);
 char*       string_findc(const string_t big, const char* little);
-bool        string_replace(string_t str, const char* pattern, const char* with);
 
-/** Returns a vector of strings, can be freed with vector_free */
-char**      string_tok(const string_t str, const char* delims);
+/** Replaces every occurrence of pattern, returns false if there were none */
+bool        string_replace(string_t* str, const char* pattern, const char* with);
 
-void        string_sprintf(string_t str, const char* fmt, ...);
+/**
+ * Returns a vector of copies of the tokens in str, which is left untouched.
+ * Empty tokens are skipped. Free the result with string_tok_free
+ *
+ * NOTE: See strview_tok_init for a tokenizer that doesn't allocate
+ */
+string_t*   string_tok(const string_t str, const char* delims);
+void        string_tok_free(string_t* tokens);
 
+/** Overwrites str with the formatted text */
+void        string_sprintf(string_t* str, const char* fmt, ...);
+void        string_appendf(string_t* str, const char* fmt, ...);
+void        string_vappendf(string_t* str, const char* fmt, va_list ap);
+
+/** ASCII only, any other byte is left as is */
 void        string_to_upper(string_t str);
 void        string_to_lower(string_t str);
 
 uint32_t    string_hash(const string_t str);
+uint64_t    string_hash64(const string_t str);
+
+
+/**
+ * Primitives on raw buffers which don't need to be null terminated. They use
+ * SSE2 on x86, switch to AVX2 at runtime when the CPU has it, and fall back to
+ * plain C everywhere else.
+ */
+
+enum
+{
+    STR_CLASS_SPACE = 1,    /* ' ', \t, \n, \v, \f, \r */
+    STR_CLASS_DIGIT,
+    STR_CLASS_ALPHA,
+    STR_CLASS_ALNUM,
+    STR_CLASS_UPPER,
+    STR_CLASS_LOWER
+};
+
+void        str_to_upper(char* str, size_t len);
+void        str_to_lower(char* str, size_t len);
+
+/** Returns the first occurrence of needle in haystack, or NULL */
+const char* str_find(const char* haystack, size_t haystack_len, const char* needle, size_t needle_len);
+
+/** Index of the first character in (find) or not in (skip) a STR_CLASS_*, len if there is none */
+size_t      str_find_class(const char* str, size_t len, int cls);
+size_t      str_skip_class(const char* str, size_t len, int cls);
+
+/** Non-cryptographic hashes (XXH64), the 32 bit one folds the 64 bit result */
+uint64_t    str_hash64(const void* data, size_t len, uint64_t seed);
+uint32_t    str_hash32(const void* data, size_t len, uint32_t seed);
+
+
+#define STRBUF_SMALL 48
+
+typedef struct strbuf_t
+{
+    size_t len;
+    size_t cap;         /* Characters that fit without growing, excluding the null terminator */
+
+    union {
+        char* heap;
+        char  small[STRBUF_SMALL];  /* Used while cap < STRBUF_SMALL */
+    } data;
+} strbuf_t;
+
+void        strbuf_init(strbuf_t* buf);
+void        strbuf_free(strbuf_t* buf);
+
+/** Empties the buffer but keeps its capacity */
+void        strbuf_clear(strbuf_t* buf);
+bool        strbuf_reserve(strbuf_t* buf, size_t len);
+
+size_t      strbuf_len(const strbuf_t* buf);
+const char* strbuf_cstr(const strbuf_t* buf);
+
+void        strbuf_append(strbuf_t* buf, const char* str);
+void        strbuf_append_n(strbuf_t* buf, const char* str, size_t len);
+void        strbuf_push(strbuf_t* buf, char c);
+void        strbuf_appendf(strbuf_t* buf, const char* fmt, ...);
+void        strbuf_vappendf(strbuf_t* buf, const char* fmt, va_list ap);
+
+/** Returns a copy of the buffer's contents as a string_t */
+string_t    strbuf_to_string(const strbuf_t* buf);
 
 
 #endif /* CORE_CSTRING_H */
@@ -0,0 +1,57 @@
+/**
+ * flatmap.h
+ *
+ * @brief A map from uint64_t keys to fixed size values, stored as two parallel
+ *        sorted arrays so iterating it visits the keys in ascending order
+ *
+ * Lookups use a branchless binary search. Once a map stops changing it can be
+ * frozen, which builds an Eytzinger (BFS) ordered copy of the keys that keeps
+ * the first levels of the search in a handful of cache lines. Any modification
+ * unfreezes the map again.
+ *
+ * Inserting a single key is O(n), so large maps should be filled with
+ * flatmap_build which radix sorts all the keys at once.
+ */
+
+#ifndef CORE_FLATMAP_H
+#define CORE_FLATMAP_H
+
+#include "engine/core/base.h"
+
+typedef struct flatmap_t
+{
+    uint64_t*       keys;       /* Sorted vector */
+    unsigned char*  values;     /* Vector of value_size * vector_size(keys) bytes */
+    size_t          value_size;
+
+    uint64_t*       eytz_keys;  /* Eytzinger ordered keys, 1 based, NULL if not frozen */
+    uint32_t*       eytz_index; /* Index into keys for each entry of eytz_keys */
+} flatmap_t;
+
+flatmap_t*  flatmap_create(size_t value_size, size_t capacity);
+void        flatmap_destroy(flatmap_t* map);
+
+size_t      flatmap_len(const flatmap_t* map);
+void        flatmap_clear(flatmap_t* map);
+
+/** Replaces the contents of the map with n unsorted key/value pairs, the last of any duplicate keys wins */
+bool        flatmap_build(flatmap_t* map, const uint64_t* keys, const void* values, size_t n);
+
+/** Inserts or overwrites key, returns a pointer to the stored value */
+void*       flatmap_insert(flatmap_t* map, uint64_t key, const void* value);
+bool        flatmap_erase(flatmap_t* map, uint64_t key);
+
+/** Returns a pointer to key's value, or NULL if key isn't in the map */
+void*       flatmap_find(const flatmap_t* map, uint64_t key);
+bool        flatmap_contains(const flatmap_t* map, uint64_t key);
+
+/** Index of the first key that is not less than key, flatmap_len if there is none */
+size_t      flatmap_lower_bound(const flatmap_t* map, uint64_t key);
+
+uint64_t    flatmap_key_at(const flatmap_t* map, size_t i);
+void*       flatmap_value_at(const flatmap_t* map, size_t i);
+
+/** Builds the Eytzinger search layout, lookups use it until the map is modified */
+void        flatmap_freeze(flatmap_t* map);
+
+#endif /* CORE_FLATMAP_H */
@@ -0,0 +1,77 @@
+/**
+ * frame.h
+ *
+ * @brief Frame timing statistics and hitch detection
+ *
+ * window_flip ends every frame. The time between two ends is the frame time,
+ * within a frame the time can be split into named phases:
+ *
+ *     frame_phase("update");
+ *     ...
+ *     frame_phase("render");
+ *     ...
+ *     window_flip(window);     (counted as the "present" phase)
+ *
+ * Statistics cover a rolling window of FRAME_WINDOW frames and are updated
+ * whenever a window completes. Percentiles come from P² estimators, so the
+ * memory used doesn't depend on the window. A frame longer than the hitch
+ * threshold is logged and kept along with a copy of the profiler's tree for it.
+ *
+ * NOTE: Everything here is meant to be called from the thread calling window_flip
+ */
+
+#ifndef CORE_FRAME_H
+#define CORE_FRAME_H
+
+#include "engine/core/profile.h"
+
+#define FRAME_WINDOW      120   /* Frames each set of statistics covers */
+#define FRAME_HISTORY     256   /* Frame times kept for graphs */
+#define FRAME_MAX_PHASES  8
+#define FRAME_MAX_HITCHES 8
+
+/** In ms */
+typedef struct frame_stats_t
+{
+    double min;
+    double avg;
+    double max;
+    double p50;
+    double p95;
+    double p99;
+} frame_stats_t;
+
+typedef struct frame_hitch_t
+{
+    uint64_t         index;
+    double           ms;
+    profile_frame_t* profile;   /* NULL when the profiler is compiled out or the copy failed */
+} frame_hitch_t;
+
+/** Ends the current phase and starts name's, name has to outlive the program (a literal) */
+void                 frame_phase(const char* name);
+
+/** Ends the frame, window_flip calls it */
+void                 frame_end(void);
+
+/** Frames longer than ms are hitches, 0 turns detection off (the default is 50) */
+void                 frame_set_hitch(double ms);
+
+uint64_t             frame_index(void);
+double               frame_last_ms(void);
+
+/** Whole frames over the last completed window, or the one in progress before that */
+void                 frame_stats(frame_stats_t* stats);
+
+size_t               frame_phase_count(void);
+const char*          frame_phase_name(size_t phase);
+void                 frame_phase_stats(size_t phase, frame_stats_t* stats);
+
+/** Copies up to max of the latest frame times in ms into out, oldest first, returns how many */
+size_t               frame_history(float* out, size_t max);
+
+/** Hitches kept, i == 0 is the latest */
+size_t               frame_hitch_count(void);
+const frame_hitch_t* frame_hitch(size_t i);
+
+#endif /* CORE_FRAME_H */
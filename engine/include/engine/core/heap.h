@@ -0,0 +1,112 @@
+/**
+ * heap.h
+ *
+ * A d-ary min-heap stored in a vector (see vector.h), so just like a vector it
+ * can be used with a plain pointer of any type. The element at the top is the
+ * one that compares lowest with cmp, which follows the same convention as qsort.
+ *
+ * Each node has HEAP_ARITY children stored next to each other, so for small
+ * element types all of them are scanned from a single cache line and the tree
+ * is half as deep as a binary heap.
+ *
+ * pqueue_t is an indexed priority queue over integer ids (graph nodes, timer
+ * slots, request handles, ...). It keeps an id -> slot index map next to the
+ * heap so the priority of a queued id can be changed in O(log n).
+ *
+ * NOTE: Any functions prefixed with heap__ or pqueue__ (two underscores) are
+ * meant for internal use and should not be called by the user
+ */
+
+#ifndef CORE_HEAP_H
+#define CORE_HEAP_H
+
+#include "engine/core/base.h"
+#include "engine/core/vector.h"
+
+#define HEAP_ARITY 4
+
+/**************************************************************
+ * Interface
+ */
+
+#define heap_init(h_)                   vector_init(h_)
+#define heap_init_with(h_, n_)          vector_init_with(h_, n_)
+#define heap_free(h_)                   vector_free(h_)
+
+#define heap_size(h_)                   vector_size(h_)
+#define heap_empty(h_)                  vector_empty(h_)
+#define heap_clear(h_)                  (vector_size(h_) = 0)
+
+/** The top element, the heap must not be empty */
+#define heap_peek(h_)                   ((h_)[0])
+
+#define heap_push(h_, val_, cmp_)       (vector_push(h_, val_),\
+                                         heap__sift_up((h_), vector_size(h_) - 1, sizeof(*(h_)), (cmp_)))
+
+/** Removes the top element and returns it, the heap must not be empty */
+#define heap_pop(h_, cmp_)              (heap__pop((h_), vector_size(h_), sizeof(*(h_)), (cmp_)),\
+                                         (h_)[--vector_size(h_)])
+
+/** Restores the heap order after the element at index i_ changed */
+#define heap_update(h_, i_, cmp_)       (heap__update((h_), vector_size(h_), (i_), sizeof(*(h_)), (cmp_)))
+
+/** Turns the contents of a vector into a heap in O(n) */
+#define heap_heapify(h_, cmp_)          (heap__heapify((h_), vector_size(h_), sizeof(*(h_)), (cmp_)))
+
+/** Initializes a heap with a copy of the n_ elements in arr_ */
+#define heap_from_array(h_, arr_, n_, cmp_)\
+                                        (vector_init_with(h_, n_),\
+                                         memcpy((h_), (arr_), (n_) * sizeof(*(h_))),\
+                                         vector_size(h_) = (n_),\
+                                         heap_heapify(h_, cmp_))
+
+#define PQUEUE_NONE UINT32_MAX
+
+typedef struct pqueue_node_t
+{
+    double   priority;
+    uint32_t id;
+} pqueue_node_t;
+
+typedef struct pqueue_t
+{
+    pqueue_node_t* nodes;   /* Heap ordered vector */
+    uint32_t*      slots;   /* Vector mapping an id to its index in nodes, or PQUEUE_NONE */
+} pqueue_t;
+
+pqueue_t*   pqueue_create(size_t capacity);
+void        pqueue_destroy(pqueue_t* queue);
+
+size_t      pqueue_len(const pqueue_t* queue);
+bool        pqueue_empty(const pqueue_t* queue);
+void        pqueue_clear(pqueue_t* queue);
+
+bool        pqueue_contains(const pqueue_t* queue, uint32_t id);
+double      pqueue_priority(const pqueue_t* queue, uint32_t id);
+
+/** Inserts id, or changes its priority if it is already queued */
+void        pqueue_push(pqueue_t* queue, uint32_t id, double priority);
+
+/** Lowers the priority of a queued id, returns false if id isn't queued or priority isn't lower */
+bool        pqueue_decrease(pqueue_t* queue, uint32_t id, double priority);
+
+/** Removes id from the queue, returns false if it wasn't queued */
+bool        pqueue_remove(pqueue_t* queue, uint32_t id);
+
+/** Returns the id with the lowest priority, or PQUEUE_NONE if the queue is empty */
+uint32_t    pqueue_peek(const pqueue_t* queue, double* priority);
+uint32_t    pqueue_pop(pqueue_t* queue, double* priority);
+
+/** Replaces the contents of the queue with n ids in O(n), ids must be unique */
+void        pqueue_heapify(pqueue_t* queue, const uint32_t* ids, const double* priorities, size_t n);
+
+/**************************************************************
+ * Internal
+ */
+
+void    heap__sift_up(void* h, size_t i, size_t type_size, int (*cmp)(const void*, const void*));
+void    heap__pop(void* h, size_t n, size_t type_size, int (*cmp)(const void*, const void*));
+void    heap__update(void* h, size_t n, size_t i, size_t type_size, int (*cmp)(const void*, const void*));
+void    heap__heapify(void* h, size_t n, size_t type_size, int (*cmp)(const void*, const void*));
+
+#endif /* CORE_HEAP_H */
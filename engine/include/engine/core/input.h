@@ -1,40 +1,197 @@
+/**
+ * input.h
+ *
+ * @brief Keyboard and mouse state, and the stream of events it's derived from
+ *
+ * The GLFW callbacks only append timestamped events to a ring buffer. Each
+ * input_poll_events starts a new batch, pumps the OS events, then applies the
+ * batch in order to the key, button, cursor and scroll state.
+ *
+ * The state answers "is it down, was it pressed this frame", kept in bitsets
+ * with a list of the keys that changed, so starting a frame and asking whether
+ * anything was pressed cost as much as the input that came in. The batch keeps
+ * what that loses, e.g. two presses of a key in one frame or the cursor's path,
+ * iterate it with input_event_count and input_event.
+ *
+ * Actions name what the game wants instead of which key does it. Bindings of
+ * keys, mouse buttons or scrolling, optionally with modifiers, are compiled into
+ * a flat table that input_poll_events runs through once, after which asking for
+ * an action is an array index. An action's value is the sum of the scales of
+ * its active bindings, so an axis is an action with e.g. D at +1 and A at -1.
+ *
+ * The batches can be recorded to a file and replayed, a replaying input takes
+ * its batches from the file, one per input_poll_events, and needs no window.
+ *
+ * NOTE: Timestamps are taken when the callback runs, i.e. when the events are
+ *       pumped, not when the OS received them. GLFW doesn't expose those
+ */
+
 #ifndef CORE_INPUT_H
 #define CORE_INPUT_H
 
 #include "engine/graphics/window.h"
+#include "engine/core/intern.h"
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define INPUT_EVENT_CAPACITY 1024  /* Power of two, the most events a frame keeps */
 
-typedef struct input_button_t
+enum
 {
-    bool down       : 1;
-    bool pressed    : 1;
-    bool released   : 1;
-} input_button_t;
+    INPUT_EVENT_KEY,
+    INPUT_EVENT_BUTTON,
+    INPUT_EVENT_MOVE,
+    INPUT_EVENT_SCROLL
+};
+
+typedef struct input_event_t
+{
+    uint64_t time;      /* time_now() when the event was pumped */
+    uint16_t type;
+    uint16_t code;      /* Key or mouse button */
+    uint8_t  action;    /* ACTION_PRESS, ACTION_RELEASE or ACTION_REPEAT */
+    uint8_t  mods;
+    float    x, y;      /* Cursor position or scroll offset */
+} input_event_t;
+
+#define INPUT_MAX_ACTIONS    64
+
+enum
+{
+    INPUT_BIND_KEY,
+    INPUT_BIND_BUTTON,
+    INPUT_BIND_SCROLL_X,
+    INPUT_BIND_SCROLL_Y
+};
+
+typedef struct input_binding_t
+{
+    uint8_t  type;
+    uint8_t  mods;      /* MOD_SHIFT, MOD_CONTROL, MOD_ALT, MOD_SUPER held, exactly. 0 doesn't look at them */
+    uint16_t code;      /* Key or mouse button */
+    float    scale;     /* Added to the value while active, scroll bindings add scale * offset */
+} input_binding_t;
+
+typedef struct input_action_t
+{
+    strid_t name;
+    float   value;
+    bool    down;
+    bool    pressed;
+    bool    released;
+} input_action_t;
+
+typedef struct input__bound_t input__bound_t;
+
+#define INPUT__KEY_COUNT 349
+#define INPUT__KEY_WORDS ((INPUT__KEY_COUNT + 63) / 64)
 
 typedef struct input_t
 {
+    const window_t* window;     /* NULL for an input only fed by replays, as with a headless window */
+
+    /* Bitsets, a bit per key */
     struct {
-        input_button_t keys[349];
+        uint64_t down[INPUT__KEY_WORDS];
+        uint64_t pressed[INPUT__KEY_WORDS];
+        uint64_t released[INPUT__KEY_WORDS];
+        uint16_t changed[INPUT__KEY_COUNT];     /* Keys pressed or released this frame, once each */
+        uint16_t changed_count;
     } keyboard;
 
+    /* A bit per button */
     struct {
-        input_button_t buttons[8];
+        uint8_t down;
+        uint8_t pressed;
+        uint8_t released;
         float xpos,    ypos;
         float xscroll, yscroll;
         bool  is_trapped;
     } mouse;
+
+    struct {
+        input_event_t events[INPUT_EVENT_CAPACITY];
+        uint64_t      head;         /* Events appended so far */
+        uint64_t      begin;        /* The current batch, [begin, end) */
+        uint64_t      end;
+        uint64_t      overflowed;   /* Left out of their batch to make room */
+    } stream;
+
+    struct {
+        input_action_t  list[INPUT_MAX_ACTIONS];
+        size_t          count;
+        input__bound_t* bound;      /* Vector, the compiled bindings of every action */
+    } actions;
+
+    bool latched;               /* Edges and the batch last until input_consume, not the next poll */
+
+    struct {
+        void*           record;     /* FILE*, while recording */
+        void*           replay;     /* FILE*, while replaying */
+        uint64_t        record_time;/* Time of the last event written */
+        uint64_t        replay_time;/* Time given to the last event read */
+        uint64_t        frames;     /* Batches written or read */
+    } recording;
 } input_t;
 
+/** window can be NULL or headless, the input then only changes through replays */
 input_t*    input_create(const window_t* window);
 void        input_destroy(input_t* input);
 
 void        input_poll_events(input_t* input);
 
+/**
+ * A latched input keeps the presses, releases, scrolling and events of every
+ * poll until input_consume clears them, rather than clearing them on the next
+ * poll, so a consumer running less often than the polls sees each edge once
+ */
+void        input_set_latched(input_t* input, bool latched);
+void        input_consume(input_t* input);
+
+/**
+ * input_poll_events that blocks until an event comes in, timeout_ns passes or
+ * window_wake is called, UINT64_MAX waits without a timeout. Never blocks
+ * without a window or while replaying
+ */
+void        input_wait_events(input_t* input, uint64_t timeout_ns);
+
+/** The events of the last input_poll_events, or since the last input_consume when latched, oldest first */
+size_t      input_event_count(const input_t* input);
+const input_event_t* input_event(const input_t* input, size_t i);
+
 bool        input_key_down(const input_t* input, int key);
 bool        input_key_pressed(const input_t* input, int key);
 bool        input_key_released(const input_t* input, int key);
 
+/** Whether any key was pressed this frame, and which keys were pressed or released, oldest first */
+bool        input_key_any_pressed(const input_t* input);
+size_t      input_key_changed_count(const input_t* input);
+int         input_key_changed(const input_t* input, size_t i);
+
+/** Returns the index of the action, adding it the first time, or -1 when there are too many */
+int         input_action(input_t* input, const char* name);
+bool        input_action_bind(input_t* input, int action, input_binding_t binding);
+void        input_action_unbind(input_t* input, int action);
+
+bool        input_action_down(const input_t* input, int action);
+bool        input_action_pressed(const input_t* input, int action);
+bool        input_action_released(const input_t* input, int action);
+float       input_action_value(const input_t* input, int action);
+
+/** Writes every batch to path from the next input_poll_events on */
+bool        input_record_start(input_t* input, const char* path);
+void        input_record_stop(input_t* input);
+
+/**
+ * Makes input_poll_events take its batches from a recording rather than the
+ * window, whose events are dropped meanwhile. Stops by itself at the end
+ */
+bool        input_replay_start(input_t* input, const char* path);
+void        input_replay_stop(input_t* input);
+bool        input_is_replaying(const input_t* input);
+
 bool        input_mouse_down(const input_t* input, int key);
 bool        input_mouse_pressed(const input_t* input, int key);
 bool        input_mouse_released(const input_t* input, int key);
@@ -47,6 +204,17 @@ float       input_mouse_yscroll(const input_t* input);
 bool        input_mouse_is_trapped(const input_t* input);
 void        input_mouse_set_trapped(input_t* input, bool trapped);
 
+/*
+ * Recording layout, in host byte order: INPUT_RECORD_MAGIC then a record per
+ * batch. Varints are LEB128, times are ns since the previous event
+ *
+ *   BATCH: varint count, count events
+ *   EVENT: u8 type | action << 4, varint time, then
+ *          KEY, BUTTON:   varint code, u8 mods
+ *          MOVE, SCROLL:  f32 x, f32 y
+ */
+#define INPUT_RECORD_MAGIC "CEINP001"
+
 enum
 {
     KEY_UNKNOWN          = 0,
@@ -0,0 +1,57 @@
+/**
+ * intern.h
+ *
+ * @brief A global pool of unique strings, each identified by a stable 32 bit id
+ *
+ * Interning a string once turns every later compare or hash of it into an
+ * integer operation, which is what asset, uniform and input action names want.
+ * The bytes live in an arena and never move, so the pointer returned by
+ * intern_get stays valid until intern_shutdown.
+ *
+ * Id 0 (INTERN_EMPTY) is always the empty string, so a zeroed strid_t is a valid name.
+ *
+ * NOTE: Interning is thread-safe. intern_get and intern_len don't take the lock
+ */
+
+#ifndef CORE_INTERN_H
+#define CORE_INTERN_H
+
+#include "engine/core/base.h"
+
+#define INTERN_EMPTY 0U
+#define INTERN_NONE  UINT32_MAX
+
+typedef uint32_t strid_t;
+
+typedef struct intern_stats_t
+{
+    size_t count;           /* Number of unique strings */
+    size_t string_bytes;    /* Bytes used by the strings, including null terminators */
+    size_t arena_bytes;     /* Bytes reserved for string storage */
+    size_t index_bytes;     /* Bytes used by the hash index */
+    size_t table_bytes;     /* Bytes used by the id -> string table */
+    size_t probes;          /* Total probes done by lookups */
+    size_t lookups;
+} intern_stats_t;
+
+/** Returns the id of str, adding it to the pool if it isn't already in it */
+strid_t     intern_string(const char* str);
+strid_t     intern_string_n(const char* str, size_t len);
+
+/** Returns the id of str, or INTERN_NONE if it was never interned */
+strid_t     intern_lookup(const char* str);
+strid_t     intern_lookup_n(const char* str, size_t len);
+
+/** Returns the null terminated string for id, or NULL if id is not valid */
+const char* intern_get(strid_t id);
+size_t      intern_len(strid_t id);
+
+void        intern_stats(intern_stats_t* stats);
+
+/** Logs the memory used by the pool */
+void        intern_report(void);
+
+/** Frees the pool, every id and string pointer handed out so far becomes invalid */
+void        intern_shutdown(void);
+
+#endif /* CORE_INTERN_H */
@@ -23,24 +23,98 @@ enum
     LOG_LEVEL_MAX = BIT(8) - 1
 };
 
-#define log_trace(...)\
-    log__log(LOG_LEVEL_TRACE, FILENAME, __LINE__, __func__, __VA_ARGS__)
+/**
+ * Levels below LOG_LEVEL_MIN (0 trace, 1 debug, 2 info, 3 warn, 4 error) are
+ * compiled out, their arguments are type checked but never evaluated. Set by
+ * the ENGINE_LOG_LEVEL_MIN CMake option
+ */
+#ifndef LOG_LEVEL_MIN
+    #define LOG_LEVEL_MIN 0
+#endif
+
+/**
+ * The module a file's messages are filtered under (see log_module_set). Define
+ * it before including anything, by default a file is its own module
+ */
+#ifndef LOG_MODULE
+    #define LOG_MODULE NULL
+#endif
+
+#define LOG_SITE_ARGS 16
+
+#define LOG__PRECISION_NONE (-1)
+#define LOG__PRECISION_ARG  (-2)    /* '*', the int argument before the string */
+
+/**
+ * Static data of a single log call, every log macro expansion owns one. The
+ * format string is parsed once, the first time the call runs
+ */
+typedef struct log_site_t
+{
+    const char*   file;
+    const char*   func;
+    int           line;
+    int           level;
+    const char*   module;
+    uint32_t      filter;               /* Filter generation << 1 | enabled, see log__enabled */
+    const char*   fmt;
+    uint32_t      id;
+    uint32_t      state;
+    uint32_t      defined;              /* Last binary log the site was written to */
+    unsigned char nargs;
+    unsigned char args[LOG_SITE_ARGS];  /* LOG_ARG_* of every argument fmt takes */
+    int16_t       precision[LOG_SITE_ARGS]; /* Of every %s, the most characters read from it */
+} log_site_t;
+
+#define LOG__SITE_INIT(level_)\
+    {"/" __FILE__, __func__, __LINE__, level_, LOG_MODULE, 0, NULL, 0, 0, 0, 0, {0}, {0}}
+
+#define LOG__SITE(level_)\
+    static log_site_t log__site_ = LOG__SITE_INIT(level_)
+
+#define LOG__CALL(level_, ...)                                                  \
+    do {                                                                        \
+        LOG__SITE(level_);                                                      \
+        if (log__enabled(&log__site_))                                          \
+            log__log(&log__site_, __VA_ARGS__);                                 \
+    } while (0)
 
-#define log_debug(...)\
-    log__log(LOG_LEVEL_DEBUG, FILENAME, __LINE__, __func__, __VA_ARGS__)
+#define LOG__STRIP(...)\
+    do { if (0) log__discard(__VA_ARGS__); } while (0)
 
-#define log_info(...)\
-    log__log(LOG_LEVEL_INFO,  FILENAME, __LINE__, __func__, __VA_ARGS__)
+#if LOG_LEVEL_MIN <= 0
+    #define log_trace(...) LOG__CALL(LOG_LEVEL_TRACE, __VA_ARGS__)
+#else
+    #define log_trace(...) LOG__STRIP(__VA_ARGS__)
+#endif
 
-#define log_warn(...)\
-    log__log(LOG_LEVEL_WARN,  FILENAME, __LINE__, __func__, __VA_ARGS__)
+#if LOG_LEVEL_MIN <= 1
+    #define log_debug(...) LOG__CALL(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+    #define log_debug(...) LOG__STRIP(__VA_ARGS__)
+#endif
 
-#define log_error(...)\
-    log__log(LOG_LEVEL_ERROR, FILENAME, __LINE__, __func__, __VA_ARGS__)
+#if LOG_LEVEL_MIN <= 2
+    #define log_info(...)  LOG__CALL(LOG_LEVEL_INFO,  __VA_ARGS__)
+#else
+    #define log_info(...)  LOG__STRIP(__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL_MIN <= 3
+    #define log_warn(...)  LOG__CALL(LOG_LEVEL_WARN,  __VA_ARGS__)
+#else
+    #define log_warn(...)  LOG__STRIP(__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL_MIN <= 4
+    #define log_error(...) LOG__CALL(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+    #define log_error(...) LOG__STRIP(__VA_ARGS__)
+#endif
 
 #define log_fatal(...)                                                          \
     do {                                                                        \
-        log__log(LOG_LEVEL_FATAL, FILENAME, __LINE__, __func__, __VA_ARGS__);   \
+        LOG__CALL(LOG_LEVEL_FATAL, __VA_ARGS__);                                \
         DEBUG_BREAK;                                                            \
     } while (0)
 
@@ -48,11 +122,106 @@ enum
     do {                                                                            \
         if (!(x_))                                                                  \
         {                                                                           \
-            log__log(LOG_LEVEL_ASSERT, FILENAME, __LINE__, __func__, __VA_ARGS__);  \
+            LOG__CALL(LOG_LEVEL_ASSERT, __VA_ARGS__);                               \
             DEBUG_BREAK;                                                            \
         }                                                                           \
     } while (0)
 
+/**
+ * Rate limited logging for calls that can fire every frame. Each wraps one of
+ * the level macros and keeps its state per call site, e.g.
+ *
+ *     log_every_n(logw, 100, "Texture %s missing", name);
+ *
+ * log_once:    only the first call is logged
+ * log_every_n: the 1st, (n+1)th, ... calls are logged, each followed by how many were skipped
+ * log_rate:    a token bucket of burst_ messages refilled at per_sec_ per second
+ * log_dedup:   identical consecutive messages are collapsed into "repeated N times",
+ *              reported once a second while they keep coming, when they change and
+ *              when the log shuts down (at exit, or log_async_stop)
+ */
+typedef struct log_limit_t
+{
+    uint32_t lock;
+    uint32_t calls;
+    uint32_t suppressed;
+    double   tokens;
+    uint64_t stamp;         /* ns */
+    uint64_t hash;
+} log_limit_t;
+
+/* A log_dedup call site, listed the first time it collapses a message so the count left at shutdown gets reported */
+typedef struct log__dedup_t log__dedup_t;
+
+struct log__dedup_t
+{
+    log_limit_t   limit;
+    log_site_t    site;     /* Of the LOG__REPEATED message */
+    log__dedup_t* next;
+    uint32_t      listed;
+};
+
+#define LOG__REPEATED "(last message repeated %u times)"
+
+#define log_once(log_, ...)                                                     \
+    do {                                                                        \
+        static uint32_t log__once_ = 0;                                         \
+        if (log__once(&log__once_))                                             \
+            log_(__VA_ARGS__);                                                  \
+    } while (0)
+
+#define log_every_n(log_, n_, ...)                                              \
+    do {                                                                        \
+        static log_limit_t log__limit_;                                         \
+        uint32_t log__skipped_ = 0;                                             \
+        if (log__every_n(&log__limit_, (n_), &log__skipped_)) {                 \
+            log_(__VA_ARGS__);                                                  \
+            if (log__skipped_)                                                  \
+                log_("(%u similar messages skipped)", log__skipped_);          \
+        }                                                                       \
+    } while (0)
+
+#define log_rate(log_, per_sec_, burst_, ...)                                   \
+    do {                                                                        \
+        static log_limit_t log__limit_;                                         \
+        uint32_t log__skipped_ = 0;                                             \
+        if (log__rate(&log__limit_, (per_sec_), (burst_), &log__skipped_)) {    \
+            log_(__VA_ARGS__);                                                  \
+            if (log__skipped_)                                                  \
+                log_("(%u similar messages skipped)", log__skipped_);          \
+        }                                                                       \
+    } while (0)
+
+/* Gated like the macro it wraps, so a stripped or filtered level doesn't format and hash the message */
+#define log_dedup(log_, ...)                                                    \
+    do {                                                                        \
+        LOG__SITE(BIT(LOG__INDEX_##log_));                                      \
+        static log__dedup_t log__dedup_ =                                       \
+            {{0}, LOG__SITE_INIT(BIT(LOG__INDEX_##log_)), NULL, 0};             \
+        uint32_t log__repeated_ = 0;                                            \
+        if (LOG_LEVEL_MIN <= LOG__INDEX_##log_ && log__enabled(&log__site_)) {  \
+            bool log__emit_ = log__dedup(&log__dedup_, &log__repeated_, __VA_ARGS__); \
+            if (log__repeated_ && log__enabled(&log__dedup_.site))              \
+                log__log(&log__dedup_.site, LOG__REPEATED, log__repeated_);     \
+            if (log__emit_)                                                     \
+                log_(__VA_ARGS__);                                              \
+        }                                                                       \
+    } while (0)
+
+/* The LOG_LEVEL_MIN index of every level macro, for the limiters that need to know it */
+#define LOG__INDEX_log_trace 0
+#define LOG__INDEX_log_debug 1
+#define LOG__INDEX_log_info  2
+#define LOG__INDEX_log_warn  3
+#define LOG__INDEX_log_error 4
+#define LOG__INDEX_log_fatal 5
+#define LOG__INDEX_logt      LOG__INDEX_log_trace
+#define LOG__INDEX_logd      LOG__INDEX_log_debug
+#define LOG__INDEX_logi      LOG__INDEX_log_info
+#define LOG__INDEX_logw      LOG__INDEX_log_warn
+#define LOG__INDEX_loge      LOG__INDEX_log_error
+#define LOG__INDEX_logf      LOG__INDEX_log_fatal
+
 #define logt(...)     log_trace(__VA_ARGS__)
 #define logd(...)     log_debug(__VA_ARGS__)
 #define logi(...)     log_info(__VA_ARGS__)
@@ -61,14 +230,152 @@ enum
 #define logf(...)     log_fatal(__VA_ARGS__)
 #define loga(x_, ...) log_assert(x_, __VA_ARGS__)
 
+/** A formatted message as the sinks receive it */
+typedef struct log_message_t
+{
+    const char* file;   /* As FILENAME gives it */
+    const char* func;
+    int         line;
+    int         level;
+    uint64_t    time;   /* time_now when the message was logged */
+    uint32_t    thread;
+    const char* msg;    /* Not null terminated */
+    size_t      len;
+} log_message_t;
+
+/**
+ * Somewhere messages are written to, see logsink.h for the built-in ones.
+ * Sinks are called one message at a time with the registry locked, from the
+ * logging thread or from the async writer. flush is called after every batch,
+ * which is every message when logging synchronously
+ */
+typedef struct log_sink_t log_sink_t;
+
+struct log_sink_t
+{
+    void          (*write)(log_sink_t* sink, const log_message_t* message);
+    void          (*flush)(log_sink_t* sink);
+    void          (*destroy)(log_sink_t* sink);
+    unsigned char mask;     /* Levels the sink receives */
+};
+
+const char* log_level_name(int level);
+
 void log_enable(unsigned char mask);
 void log_disable(unsigned char mask);
 
-void log__log(int level,
-              const char* file,
-              int line,
-              const char* func,
-              const char* fmt,
-              ...);
+bool log_sink_add(log_sink_t* sink);
+void log_sink_remove(log_sink_t* sink);
+
+/** The colored stderr sink, registered from the start */
+log_sink_t* log_console(void);
+
+/**
+ * Replaces the global level mask for one module, either a LOG_MODULE name or a
+ * file name like "input.c". Changing any filter costs every call site one
+ * lookup the next time it runs, after that the check is inline again
+ */
+void log_module_set(const char* module, unsigned char mask);
+
+/** Removes every module override */
+void log_module_reset(void);
+
+/**
+ * Moves writing the log off the calling threads. Each thread formats its
+ * messages into its own lock-free ring buffer and a background thread writes
+ * them out in batches. A message is dropped (and counted) instead of blocking
+ * when its thread's buffer is full. Fatal and assert messages are never queued,
+ * they flush the queue and are written immediately.
+ *
+ * log_async_stop drains the queue, it's also called at exit
+ */
+void log_async_start(void);
+void log_async_stop(void);
+
+/** Blocks until every message queued so far has been written */
+void log_flush(void);
+
+/** Number of messages dropped because a ring buffer was full */
+unsigned log_dropped(void);
+
+/**
+ * Writes whatever hasn't reached the console yet, both messages still queued
+ * for the async writer and the console's unflushed batch, to fd. Only uses
+ * write(2) and takes no locks, it's meant for crash handlers
+ */
+void log_crash_dump(int fd);
+
+/**
+ * Deferred formatting. Instead of text, every message is written to path as
+ * its call site id followed by the raw bytes of its arguments, each call site
+ * is described once per file. tools/logdecode turns the file back into text.
+ * Fatal and assert messages still go to stderr as well.
+ *
+ * Arguments are recorded by the types their format asks for, sites using %n
+ * or more than LOG_SITE_ARGS arguments are formatted up front instead
+ */
+bool log_binary_start(const char* path);
+void log_binary_stop(void);
+
+/*
+ * Binary log layout, in host byte order: LOG_BINARY_MAGIC then a sequence of
+ * records, each starting with its LOG_BINARY_* byte
+ *
+ *   SITE:    u32 id, u8 level, u32 line, u8 nargs, u8 args[nargs],
+ *            u16 len + file, u16 len + func, u16 len + fmt
+ *   MESSAGE: u32 id, u16 len, arguments (8 bytes each, strings as u16 len + bytes)
+ *   TEXT:    u32 id, u16 len, formatted message
+ */
+#define LOG_BINARY_MAGIC "CELOG001"
+
+enum
+{
+    LOG_BINARY_SITE = 1,
+    LOG_BINARY_MESSAGE,
+    LOG_BINARY_TEXT
+};
+
+enum
+{
+    LOG_ARG_INT = 1,
+    LOG_ARG_LONG,
+    LOG_ARG_LLONG,
+    LOG_ARG_SIZE,
+    LOG_ARG_INTMAX,
+    LOG_ARG_PTRDIFF,
+    LOG_ARG_PTR,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_LDOUBLE,    /* Recorded as a double */
+    LOG_ARG_STRING,
+
+    LOG_ARG_TEXT = 0xff /* nargs of a site whose messages are formatted up front */
+};
+
+extern uint32_t log__generation;
+
+bool log__refresh(log_site_t* site);
+bool log__once(uint32_t* once);
+bool log__every_n(log_limit_t* limit, uint32_t n, uint32_t* skipped);
+bool log__rate(log_limit_t* limit, double per_sec, uint32_t burst, uint32_t* skipped);
+bool log__dedup(log__dedup_t* dedup, uint32_t* repeated, const char* fmt, ...);
+void log__log(log_site_t* site, const char* fmt, ...);
+
+/* Whether the site's level is enabled for its module, re-evaluated whenever a filter changes */
+static inline bool
+log__enabled(log_site_t* site)
+{
+    uint32_t filter = __atomic_load_n(&site->filter, __ATOMIC_RELAXED);
+
+    if (filter >> 1 == __atomic_load_n(&log__generation, __ATOMIC_RELAXED))
+        return filter & 1;
+
+    return log__refresh(site);
+}
+
+static inline void
+log__discard(const char* fmt, ...)
+{
+    UNUSED(fmt);
+}
 
 #endif /* CORE_LOG_H */
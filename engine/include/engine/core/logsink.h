@@ -0,0 +1,53 @@
+/**
+ * logsink.h
+ *
+ * @brief Log sinks besides the console: rotating text or JSON lines files and
+ *        an in-memory ring of the latest messages
+ *
+ * A sink receives nothing until it's passed to log_sink_add. File sinks buffer
+ * their writes and only hand them to the OS when the log flushes a batch.
+ *
+ * The ring sink is meant for crash reports and in-game consoles, it keeps the
+ * last N messages formatted like the console (without colors).
+ */
+
+#ifndef CORE_LOGSINK_H
+#define CORE_LOGSINK_H
+
+#include "engine/core/log.h"
+
+#define LOGSINK_RING_LINE 256
+
+enum
+{
+    LOGSINK_TEXT,
+    LOGSINK_JSON    /* One object per line: time, level, file, line, func, thread and msg */
+};
+
+typedef struct logsink_file_props_t
+{
+    const char* path;
+    int         format;     /* LOGSINK_TEXT or LOGSINK_JSON */
+    size_t      max_size;   /* Rotate once the file holds this many bytes, 0 for never */
+    uint32_t    max_age;    /* Rotate once the file is this many seconds old, 0 for never */
+    unsigned    keep;       /* Rotated files kept, path.1 being the newest */
+    size_t      buffer;     /* Write buffer size, 0 for 64 KiB */
+} logsink_file_props_t;
+
+log_sink_t* logsink_file_create(const logsink_file_props_t* props);
+
+log_sink_t* logsink_ring_create(size_t lines);
+
+/** Number of lines currently held */
+size_t      logsink_ring_count(log_sink_t* sink);
+
+/** Copies line i (0 is the oldest) into buf and returns its level, or 0 if there is no such line */
+int         logsink_ring_line(log_sink_t* sink, size_t i, char* buf, size_t size);
+
+/** Writes every line to fd using nothing but write(2), so it's safe to call from a signal handler */
+void        logsink_ring_dump(log_sink_t* sink, int fd);
+
+/** Removes the sink from the log if it was added, then flushes and frees it */
+void        logsink_destroy(log_sink_t* sink);
+
+#endif /* CORE_LOGSINK_H */
@@ -23,6 +23,22 @@
 
 void memory_init(void);
 
+typedef struct memory_stats_t
+{
+    size_t total;       /* Bytes ever allocated */
+    size_t current;     /* Bytes allocated right now */
+    size_t peak;
+
+    int failed;
+    int mallocs;
+    int callocs;
+    int reallocs;
+    int frees;
+} memory_stats_t;
+
+/** Copies the tracker's counters, doesn't lock or allocate so a crash handler may call it */
+void memory_stats(memory_stats_t* stats);
+
 /* To avoid recursive expansions the actual memory functions */
 #ifndef MEMORY_RECURSION_GUARD
     #define malloc(size_)           mem__alloc(size_ MEM_DEBUG_PARAMS_IMPL)
@@ -0,0 +1,132 @@
+/**
+ * profile.h
+ *
+ * @brief Instrumentation profiler aggregating zones into a call tree per frame
+ *
+ * Zones are marked with PROFILE_SCOPE, which times the rest of the enclosing
+ * block, or with PROFILE_BEGIN/PROFILE_END pairs:
+ *
+ *     void physics_step(world_t* world)
+ *     {
+ *         PROFILE_FUNCTION();
+ *         ...
+ *         {
+ *             PROFILE_SCOPE("broadphase");
+ *             ...
+ *         }
+ *     }
+ *
+ * Every thread records its begin/end timestamps into its own lock-free ring
+ * buffer. profile_frame, which window_flip calls, drains the rings into a call
+ * tree per thread with the calls, inclusive and exclusive time of every zone.
+ * Zones still open at the frame boundary are split across both frames.
+ *
+ * PROFILE_ENABLED 0 (the ENGINE_PROFILE CMake option) compiles the macros out,
+ * the functions then report empty frames
+ *
+ * NOTE: PROFILE_SCOPE relies on __attribute__((cleanup)), with MSVC only the
+ *       BEGIN/END pairs are recorded
+ */
+
+#ifndef CORE_PROFILE_H
+#define CORE_PROFILE_H
+
+#include "engine/core/base.h"
+
+#include <stdio.h>
+
+#ifndef PROFILE_ENABLED
+    #define PROFILE_ENABLED 1
+#endif
+
+/** Static data of a zone, every macro expansion owns one */
+typedef struct profile_zone_t
+{
+    const char* name;
+    const char* file;
+    int         line;
+} profile_zone_t;
+
+/* Names unique to one macro expansion, even with several on a line */
+#define PROFILE__NAME(x_, id_) CAT(x_, id_)
+
+#define PROFILE__ZONE(name_, id_)\
+    static const profile_zone_t PROFILE__NAME(profile__zone_, id_) = {name_, "/" __FILE__, __LINE__}
+
+#define PROFILE__SCOPE(name_, id_)                                              \
+    PROFILE__ZONE(name_, id_);                                                  \
+    const profile_zone_t* PROFILE__NAME(profile__scope_, id_)                   \
+        __attribute__((cleanup(profile__scope_end))) = profile__begin(&PROFILE__NAME(profile__zone_, id_))
+
+#if PROFILE_ENABLED && !COMPILER_MSVC
+    #define PROFILE_SCOPE(name_) PROFILE__SCOPE(name_, __COUNTER__)
+#else
+    #define PROFILE_SCOPE(name_) do { } while (0)
+#endif
+
+#if PROFILE_ENABLED
+    #define PROFILE_BEGIN(name_)                                                \
+        do {                                                                    \
+            PROFILE__ZONE(name_, 0);                                            \
+            profile__begin(&profile__zone_0);                                   \
+        } while (0)
+
+    #define PROFILE_END() profile__end()
+#else
+    #define PROFILE_BEGIN(name_) do { } while (0)
+    #define PROFILE_END()        do { } while (0)
+#endif
+
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+
+/** A zone within the call tree, times are ns spent in the frame */
+typedef struct profile_node_t
+{
+    const profile_zone_t* zone;
+    uint32_t              thread;
+    uint32_t              depth;        /* 0 for the thread's outermost zones */
+    uint32_t              calls;        /* Zones that ended this frame */
+    uint64_t              inclusive;
+    uint64_t              exclusive;    /* Minus the time spent in child zones */
+} profile_node_t;
+
+typedef struct profile_frame_t
+{
+    uint64_t        index;
+    uint64_t        start;      /* time_now at the previous boundary */
+    uint64_t        duration;
+    size_t          count;
+    profile_node_t* nodes;      /* Depth first, one tree per thread in the order they started profiling */
+} profile_frame_t;
+
+/**
+ * Marks a frame boundary and aggregates every zone recorded since the last
+ * one, call it from one thread only (window_flip does without a window). The
+ * result is what profile_last returns
+ */
+void                    profile_frame(void);
+
+/** The last aggregated frame, valid until the next profile_frame */
+const profile_frame_t*  profile_last(void);
+
+/** A copy of frame that outlives it, free it with profile_release */
+profile_frame_t*        profile_capture(const profile_frame_t* frame);
+void                    profile_release(profile_frame_t* frame);
+
+/** Writes frame as an indented tree with calls, inclusive and exclusive ms */
+void                    profile_print(const profile_frame_t* frame, FILE* file);
+
+/** Number of zones dropped because a thread's ring buffer was full */
+unsigned                profile_dropped(void);
+
+const profile_zone_t*   profile__begin(const profile_zone_t* zone);
+void                    profile__end(void);
+
+static inline void
+profile__scope_end(const profile_zone_t** zone)
+{
+    UNUSED(zone);
+    profile__end();
+}
+
+#endif /* CORE_PROFILE_H */
@@ -0,0 +1,27 @@
+/**
+ * sort.h
+ *
+ * @brief LSD radix sorts for integer keys with an optional uint32_t payload
+ *        (usually an index into the array of things being sorted, e.g. draw calls)
+ *
+ * The sorts are stable, use 8 bit digits and skip any pass in which every key
+ * has the same digit, so keys that only use their low bits sort in fewer passes.
+ *
+ * The _mt variants split every pass into chunks that are counted and scattered
+ * on separate threads. They fall back to the single threaded sort for small inputs.
+ */
+
+#ifndef CORE_SORT_H
+#define CORE_SORT_H
+
+#include "engine/core/base.h"
+
+/** Sorts n keys in ascending order, vals (may be NULL) is permuted along with them */
+void    sort_radix_u32(uint32_t* keys, uint32_t* vals, size_t n);
+void    sort_radix_u64(uint64_t* keys, uint32_t* vals, size_t n);
+
+/** Same as above but uses up to 'threads' threads, 0 uses one per hardware thread */
+void    sort_radix_u32_mt(uint32_t* keys, uint32_t* vals, size_t n, unsigned threads);
+void    sort_radix_u64_mt(uint64_t* keys, uint32_t* vals, size_t n, unsigned threads);
+
+#endif /* CORE_SORT_H */
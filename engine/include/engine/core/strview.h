@@ -0,0 +1,89 @@
+/**
+ * strview.h
+ *
+ * @brief A non-owning view of a run of characters (pointer + length)
+ *
+ * Views never allocate and never write to the characters they point at, so
+ * they can slice a large buffer (a config file, an asset manifest, ...) into
+ * pieces without copying it. The characters don't have to be null terminated.
+ *
+ * Printing a view: printf("%.*s", STRVIEW_ARG(sv))
+ *
+ * NOTE: A view is only valid as long as the characters it points at are
+ */
+
+#ifndef CORE_STRVIEW_H
+#define CORE_STRVIEW_H
+
+#include "engine/core/base.h"
+#include "engine/core/cstring.h"
+
+#define STRVIEW_NPOS ((size_t)-1)
+
+/** A view of a string literal, without calling strlen */
+#define STRVIEW(lit_)       ((strview_t){(lit_), sizeof(lit_) - 1})
+#define STRVIEW_ARG(sv_)    (int)(sv_).len, (sv_).ptr
+
+typedef struct strview_t
+{
+    const char* ptr;
+    size_t      len;
+} strview_t;
+
+/** Iterates over the tokens of a view, see strview_tok_next */
+typedef struct strview_tok_t
+{
+    strview_t rest;
+    uint8_t   delims[32];   /* Bitset of delimiter characters */
+} strview_tok_t;
+
+strview_t   strview_from(const char* c_str);
+strview_t   strview_from_n(const char* c_str, size_t len);
+strview_t   strview_from_string(const string_t str);
+
+/** Returns an owned copy of the view */
+string_t    strview_to_string(strview_t sv);
+
+bool        strview_empty(strview_t sv);
+bool        strview_eq(strview_t a, strview_t b);
+bool        strview_eq_cstr(strview_t a, const char* b);
+int         strview_cmp(strview_t a, strview_t b);
+
+bool        strview_starts_with(strview_t sv, strview_t prefix);
+bool        strview_ends_with(strview_t sv, strview_t suffix);
+
+/** These return the index of the match, or STRVIEW_NPOS */
+size_t      strview_find(strview_t sv, strview_t needle);
+size_t      strview_find_char(strview_t sv, char c);
+size_t      strview_rfind_char(strview_t sv, char c);
+size_t      strview_find_any(strview_t sv, const char* set);
+
+/** The view of len characters starting at pos, clamped to the end of sv */
+strview_t   strview_sub(strview_t sv, size_t pos, size_t len);
+
+/** Strip whitespace from the start, end or both ends */
+strview_t   strview_ltrim(strview_t sv);
+strview_t   strview_rtrim(strview_t sv);
+strview_t   strview_trim(strview_t sv);
+
+/**
+ * Splits sv at the first occurrence of delim into head and tail (either may be NULL).
+ * Returns false and sets head to sv and tail to an empty view if delim isn't found
+ */
+bool        strview_split(strview_t sv, char delim, strview_t* head, strview_t* tail);
+
+/**
+ * Tokenizer: like strtok, except it doesn't modify its input, keeps its state
+ * in the iterator and never allocates. Empty tokens are skipped.
+ *
+ *  strview_tok_t it;
+ *  strview_t token;
+ *
+ *  strview_tok_init(&it, line, " \t");
+ *  while (strview_tok_next(&it, &token))
+ *      ...
+ */
+void        strview_tok_init(strview_tok_t* it, strview_t sv, const char* delims);
+bool        strview_tok_next(strview_tok_t* it, strview_t* token);
+
+#endif /* CORE_STRVIEW_H */
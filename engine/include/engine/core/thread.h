@@ -0,0 +1,69 @@
+/**
+ * thread.h
+ *
+ * @brief A thin wrapper around the platform's threads, mutexes and atomics
+ *
+ * Only POSIX threads are supported, the engine doesn't build elsewhere yet.
+ *
+ * NOTE: The atomic macros work on plain integer and pointer lvalues and use
+ *       acquire/release ordering unless stated otherwise
+ */
+
+#ifndef CORE_THREAD_H
+#define CORE_THREAD_H
+
+#include "engine/core/base.h"
+
+#if !PLATFORM_POSIX
+    #error "thread.h needs pthreads"
+#endif
+
+#include <pthread.h>
+
+#define THREAD_LOCAL __thread
+
+typedef pthread_t       thread_t;
+typedef pthread_mutex_t mutex_t;
+typedef pthread_cond_t  cond_t;
+
+/** Static initializers for a mutex_t and a cond_t, which then don't need mutex_init or cond_init */
+#define MUTEX_INIT PTHREAD_MUTEX_INITIALIZER
+#define COND_INIT  PTHREAD_COND_INITIALIZER
+
+bool        thread_create(thread_t* thread, void* (*fn)(void* arg), void* arg);
+void*       thread_join(thread_t thread);
+
+/** A small id unique to the calling thread, assigned in the order threads first ask for it */
+uint32_t    thread_id(void);
+
+/** Number of hardware threads, always at least 1 */
+unsigned    thread_count(void);
+
+void        thread_yield(void);
+void        thread_sleep(uint64_t ns);
+
+void        mutex_init(mutex_t* mutex);
+void        mutex_destroy(mutex_t* mutex);
+void        mutex_lock(mutex_t* mutex);
+void        mutex_unlock(mutex_t* mutex);
+
+/** cond_wait releases mutex while it waits, wakes up spuriously too, so wait in a loop on the condition */
+void        cond_init(cond_t* cond);
+void        cond_destroy(cond_t* cond);
+void        cond_wait(cond_t* cond, mutex_t* mutex);
+void        cond_signal(cond_t* cond);
+void        cond_broadcast(cond_t* cond);
+
+#define atomic_get(p_)              __atomic_load_n((p_), __ATOMIC_ACQUIRE)
+#define atomic_get_relaxed(p_)      __atomic_load_n((p_), __ATOMIC_RELAXED)
+#define atomic_set(p_, v_)          __atomic_store_n((p_), (v_), __ATOMIC_RELEASE)
+#define atomic_set_relaxed(p_, v_)  __atomic_store_n((p_), (v_), __ATOMIC_RELAXED)
+
+/** Returns the value before the addition */
+#define atomic_add(p_, v_)          __atomic_fetch_add((p_), (v_), __ATOMIC_ACQ_REL)
+
+/** Returns true and stores desired_ if *p_ == *expected_, otherwise loads *p_ into *expected_ */
+#define atomic_cas(p_, expected_, desired_)\
+    __atomic_compare_exchange_n((p_), (expected_), (desired_), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+
+#endif /* CORE_THREAD_H */
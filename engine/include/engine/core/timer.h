@@ -1,17 +1,56 @@
+/**
+ * timer.h
+ *
+ * @brief Monotonic time in 64 bit integer nanoseconds
+ *
+ * time_now reads the OS monotonic clock. Once time_calibrate succeeds (x86
+ * with an invariant TSC) it reads the TSC instead and scales it to
+ * nanoseconds, which takes a few ns rather than a clock_gettime call. Either
+ * way the values are nanoseconds on the same timeline.
+ *
+ * A timer is just the time_now value it was started at.
+ */
+
 #ifndef CORE_TIMER_H
 #define CORE_TIMER_H
 
-typedef double timer_t;
+#include "engine/core/base.h"
+
+#define TIME_NS_PER_US  1000ULL
+#define TIME_NS_PER_MS  1000000ULL
+#define TIME_NS_PER_SEC 1000000000ULL
+
+uint64_t        time_now(void);
+
+/**
+ * Measures the TSC against the OS clock for about 10 ms and switches time_now
+ * over to it. Returns false, leaving time_now on the OS clock, where the TSC
+ * isn't usable
+ */
+bool            time_calibrate(void);
+
+/** Whether time_now is reading the TSC */
+bool            time_is_fast(void);
 
-double          time_now(void);
+uint64_t        timer_start(void);
 
-timer_t         timer_start(void);
-double          timer_stop(timer_t* timer);
-double          timer_split(timer_t* timer);
-double          timer_read(const timer_t timer);
+/** Elapsed ns, the timer keeps running */
+uint64_t        timer_read(uint64_t timer);
+
+/** Elapsed ns, restarts the timer */
+uint64_t        timer_split(uint64_t* timer);
+
+/** Elapsed ns, resets the timer to 0 */
+uint64_t        timer_stop(uint64_t* timer);
 
 /* buf should be at least 16 characters long */
 void            time_stamp(char* buf);
 
-#endif /* CORE_TIMER_H */
+static inline double   time_to_sec(uint64_t ns)   { return (double)ns / (double)TIME_NS_PER_SEC; }
+static inline double   time_to_ms(uint64_t ns)    { return (double)ns / (double)TIME_NS_PER_MS; }
+static inline double   time_to_us(uint64_t ns)    { return (double)ns / (double)TIME_NS_PER_US; }
+static inline uint64_t time_from_sec(double sec)  { return (uint64_t)(sec * (double)TIME_NS_PER_SEC); }
+static inline uint64_t time_from_ms(double ms)    { return (uint64_t)(ms * (double)TIME_NS_PER_MS); }
+static inline uint64_t time_from_us(double us)    { return (uint64_t)(us * (double)TIME_NS_PER_US); }
 
+#endif /* CORE_TIMER_H */
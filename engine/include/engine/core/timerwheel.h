@@ -0,0 +1,78 @@
+/**
+ * timerwheel.h
+ *
+ * @brief A hierarchical timer wheel, scheduling and cancelling are O(1)
+ *
+ * Time is split into ticks of tick_ns. Level 0 has a slot for each of the next
+ * 64 ticks, every level above covers 64 times the span of the one below, and
+ * timers beyond the last level wait in an overflow list. When time reaches a
+ * slot of a higher level its timers are spread over the levels below, so each
+ * timer is touched at most once per level.
+ *
+ * timerwheel_advance runs the callbacks of every timer that expired, in tick
+ * order. Callbacks may schedule and cancel timers, including their own.
+ *
+ * A timer fires on the first tick at or after its delay, never early. Ids of
+ * fired or cancelled timers stay invalid, cancelling them again is harmless.
+ *
+ * NOTE: Not thread safe, a wheel belongs to the thread advancing it
+ */
+
+#ifndef CORE_TIMERWHEEL_H
+#define CORE_TIMERWHEEL_H
+
+#include "engine/core/base.h"
+
+#define TIMERWHEEL_LEVELS    6
+#define TIMERWHEEL_SLOT_BITS 6
+#define TIMERWHEEL_SLOTS     (1 << TIMERWHEEL_SLOT_BITS)
+
+#define TIMERWHEEL__OVERFLOW (TIMERWHEEL_LEVELS * TIMERWHEEL_SLOTS)
+#define TIMERWHEEL__EXPIRING (TIMERWHEEL__OVERFLOW + 1)
+#define TIMERWHEEL__LISTS    (TIMERWHEEL__OVERFLOW + 2)
+
+/** 0 is never a valid id */
+typedef uint64_t timer_id_t;
+
+typedef void (*timer_fn_t)(void* arg);
+
+typedef struct timerwheel__node_t timerwheel__node_t;
+
+typedef struct timerwheel_t
+{
+    uint64_t            tick_ns;
+    uint64_t            start;      /* time_now of tick 0 */
+    uint64_t            now;        /* Current tick */
+    size_t              count;      /* Timers scheduled */
+
+    timerwheel__node_t* nodes;      /* Vector, timers refer to each other by index */
+    uint32_t            free;       /* Unused nodes */
+
+    uint32_t            lists[TIMERWHEEL__LISTS];   /* Every slot, then the overflow and the timers firing */
+    uint64_t            occupied[TIMERWHEEL_LEVELS];/* A bit per non-empty slot */
+} timerwheel_t;
+
+/** now is the time the wheel starts at, usually time_now() */
+timerwheel_t*   timerwheel_create(uint64_t tick_ns, uint64_t now);
+void            timerwheel_destroy(timerwheel_t* wheel);
+
+/**
+ * Calls fn(arg) delay_ns from the wheel's current time, then every interval_ns
+ * if that isn't 0, until it's cancelled
+ */
+timer_id_t      timerwheel_schedule(timerwheel_t* wheel, uint64_t delay_ns, uint64_t interval_ns, timer_fn_t fn, void* arg);
+
+/** Returns false if the timer already fired or was cancelled */
+bool            timerwheel_cancel(timerwheel_t* wheel, timer_id_t id);
+bool            timerwheel_pending(const timerwheel_t* wheel, timer_id_t id);
+
+/**
+ * When the next tick with anything to do is, UINT64_MAX without timers. That can
+ * be before the next timer expires, when timers move down a level on the way
+ */
+uint64_t        timerwheel_next_time(const timerwheel_t* wheel);
+
+/** Moves the wheel to now and runs everything that expired on the way, returns how many fired */
+size_t          timerwheel_advance(timerwheel_t* wheel, uint64_t now);
+
+#endif /* CORE_TIMERWHEEL_H */
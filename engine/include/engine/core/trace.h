@@ -0,0 +1,47 @@
+/**
+ * trace.h
+ *
+ * @brief A flight recorder of timeline events, exported as Chrome trace JSON
+ *
+ * While tracing, the last props.capacity events are kept in a ring buffer:
+ *  - profiler zones, as profile_frame collects them
+ *  - log messages, through a sink (binary logging doesn't reach the sinks)
+ *  - allocations of at least props.alloc_spike bytes
+ *  - frames, from one window_flip to the next, with the memory in use
+ *
+ * trace_export writes them in the Chrome Trace Event format, which both
+ * chrome://tracing and ui.perfetto.dev open. With props.hitch_ms set, a frame
+ * taking longer than that is exported to a file of its own right away. The
+ * frame only pays for copying the events, a thread started by trace_start
+ * writes the file
+ */
+
+#ifndef CORE_TRACE_H
+#define CORE_TRACE_H
+
+#include "engine/core/profile.h"
+
+#define TRACE_DEFAULT_CAPACITY    16384
+#define TRACE_DEFAULT_ALLOC_SPIKE (1024 * 1024)
+
+typedef struct trace_props_t
+{
+    size_t      capacity;       /* Events kept, 0 for TRACE_DEFAULT_CAPACITY */
+    size_t      alloc_spike;    /* Smallest allocation recorded in B, 0 for TRACE_DEFAULT_ALLOC_SPIKE */
+    double      hitch_ms;       /* 0 disables hitch exports */
+    const char* hitch_prefix;   /* Hitches are written to <prefix><frame index>.json, NULL for "hitch_" */
+} trace_props_t;
+
+bool trace_start(const trace_props_t* props);
+void trace_stop(void);
+
+/** Writes every event currently held to path */
+bool trace_export(const char* path);
+
+/** Marks a frame boundary, window_flip calls it */
+void trace_frame(void);
+
+void trace__zone(uint32_t thread, const profile_zone_t* zone, uint64_t begin, uint64_t end);
+void trace__alloc(size_t size, const char* file, int line);
+
+#endif /* CORE_TRACE_H */
@@ -54,10 +54,12 @@
 #define vector_push_front(v_, val_) (vector_insert(v_, 0, val_))
 #define vector_pop(v_)              (vector__shrink_maybe(v_), (v_)[--vector_size(v_)])
 
-#define vector_push_n(v_, n_)       (vector_insert_n(v_, vector_size(v_), n_))
+#define vector_push_n(v_, n_)       (vector__grow_maybe(v_, n_),\
+                                     vector_size(v_) += (n_),\
+                                     (v_) + vector_size(v_) - (n_))
 
-#define vector_insert_n(v_, i_, n_) (vector__grow_maybe(v_),\
-                                     memmove((v_) + (i_) + (n_), (v_) + (i_), (vector_size(v_) - (i_) - (n_)) * sizeof(*(v_))),\
+#define vector_insert_n(v_, i_, n_) (vector__grow_maybe(v_, n_),\
+                                     memmove((v_) + (i_) + (n_), (v_) + (i_), (vector_size(v_) - (i_)) * sizeof(*(v_))),\
                                      vector_size(v_) += (n_),\
                                      (v_) + (i_))
 
@@ -70,9 +72,11 @@
  */
 
 void*   vector__resize(void* v, size_t n, size_t type_size);
+void*   vector__grow(void* v, size_t n, size_t type_size);
 
-#define vector__grow_maybe(v_)      (!(v_) || vector_size(v_) > vector_capacity(v_)\
-                                    ? ((v_) = vector__resize(v_, vector_size(v_) << 1, sizeof(*(v_))), 0) : 0)
+/* Makes room for n_ more elements, at least doubling the capacity when it has to grow */
+#define vector__grow_maybe(v_, n_)  (!(v_) || vector_size(v_) + (n_) > vector_capacity(v_)\
+                                    ? ((v_) = vector__grow(v_, (n_), sizeof(*(v_))), 0) : 0)
 
 #define vector__shrink_maybe(v_)    (!(v_) || (vector_size(v_) && vector_size(v_) < vector_capacity(v_) >> 2)\
                                     ? ((v_) = vector__resize(v_, vector_capacity(v_) >> 1, sizeof(*(v_))), 0) : 0)
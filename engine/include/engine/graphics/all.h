@@ -2,6 +2,7 @@
 #define GRAPHICS_ALL_H
 
 #include "layer.h"
+#include "overlay.h"
 #include "renderer.h"
 #include "window.h"
 
@@ -0,0 +1,18 @@
+/**
+ * overlay.h
+ *
+ * @brief Nuklear windows showing the engine's diagnostics
+ */
+
+#ifndef GRAPHICS_OVERLAY_H
+#define GRAPHICS_OVERLAY_H
+
+#include "nuklear/nuklear.h"
+
+/**
+ * A window with the frame time graph, the frame and phase statistics from
+ * frame.h and the latest hitches with their profiler trees
+ */
+void overlay_frame_stats(struct nk_context* ctx, struct nk_rect bounds);
+
+#endif /* GRAPHICS_OVERLAY_H */
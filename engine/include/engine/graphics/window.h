@@ -1,7 +1,21 @@
+/**
+ * window.h
+ *
+ * @brief The OS window and its GL context, or a stand-in for machines without a display
+ *
+ * A WINDOW_HEADLESS window has no OS window and no GL context, its clock is
+ * virtual and each window_flip moves it a frame ahead, so the main loop, input
+ * replays and CPU-side rendering run as fast as they can yet see the same
+ * time every run. A WINDOW_OFFSCREEN window is a hidden one with a software GL
+ * context from Mesa's OSMesa, for running real GL code, it needs the engine
+ * built with ENGINE_OSMESA.
+ */
+
 #ifndef GRAPHICS_WINDOW_H
 #define GRAPHICS_WINDOW_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #define WINDOWPOS_CENTERED 0
 
@@ -19,10 +33,13 @@ typedef struct window_props_t
 
 typedef struct window_t
 {
-    void* window;
+    void* window;           /* GLFWwindow*, NULL when headless */
 
     window_props_t props;
 
+    uint64_t clock;         /* Virtual time of a headless window */
+    uint64_t frame_ns;      /* How far each flip moves it */
+
     /* Flags */
     bool is_maximized   : 1;
     bool is_minimized   : 1;
@@ -30,6 +47,7 @@ typedef struct window_t
     bool is_movable     : 1;
     bool is_focused     : 1;
     bool is_vsync       : 1;
+    bool is_headless    : 1;
 } window_t;
 
 enum
@@ -39,17 +57,37 @@ enum
     WINDOW_NOT_RESIZABLE = 1U << 2,
     WINDOW_NOT_MOVABLE   = 1U << 3,
     WINDOW_STATIC        = WINDOW_NOT_RESIZABLE | WINDOW_NOT_MOVABLE,
+    WINDOW_HEADLESS      = 1U << 4,
+    WINDOW_OFFSCREEN     = 1U << 5,
 };
 
+/** Returns NULL when the window or its context can't be created */
 window_t*   window_create(window_props_t* props);
 void        window_destroy(window_t* window);
 
-void        window_flip(const window_t* window);
+void        window_flip(window_t* window);
 
 void        window_set_vsync(window_t* window, bool vsync);
 bool        window_is_vsync(const window_t* window);
 
 bool        window_is_open(const window_t* window);
+bool        window_is_headless(const window_t* window);
+
+/** time_now, or the virtual clock of a headless window */
+uint64_t    window_time(const window_t* window);
+
+/**
+ * Makes the GL context current on the calling thread, or with current false
+ * releases it from there, so another thread can take it. window_create leaves
+ * it current on the thread that created the window
+ */
+void        window_set_current(const window_t* window, bool current);
+
+/** Makes a thread blocked in input_wait_events return, can be called from any thread */
+void        window_wake(const window_t* window);
+
+/** How far each window_flip moves a headless window's clock, 1/60 s by default */
+void        window_set_frame_time(window_t* window, uint64_t ns);
 
 void        window_maximize(window_t* window);
 void        window_minimize(window_t* window);
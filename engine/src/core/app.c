@@ -0,0 +1,481 @@
+#include "engine/core/app.h"
+#include "engine/core/crash.h"
+#include "engine/core/frame.h"
+#include "engine/core/log.h"
+#include "engine/core/memory.h"
+#include "engine/core/profile.h"
+#include "engine/core/thread.h"
+#include "engine/core/timer.h"
+
+#define APP__UPDATE_HZ   60.0
+#define APP__MAX_UPDATES 5
+#define APP__MIN_SLACK   (200 * TIME_NS_PER_US)    /* Spun at least this long before every deadline */
+#define APP__MAX_SLACK   (2 * TIME_NS_PER_MS)      /* And at most, a wake-up after a suspend or a debugger stop isn't a trend */
+#define APP__TIMER_TICK  TIME_NS_PER_MS
+
+/* Hands frame packets from app_run's thread to the render thread */
+struct app__renderer_t
+{
+    thread_t thread;
+    mutex_t  lock;
+    cond_t   ready;         /* Signalled when a packet is published or taken, and to stop */
+    double   alpha[2];
+    int      pending;       /* Published and not taken yet, -1 for none */
+    int      drawing;       /* -1 for none */
+    bool     stop;
+    bool     started;
+};
+
+static bool     app__create_renderer(app_t* app, bool threaded);
+static void     app__start_renderer(app_t* app);
+static void     app__stop_renderer(app_t* app);
+static void*    app__render_main(void* arg);
+static void     app__run_fixed(app_t* app);
+static void     app__run_events(app_t* app);
+static void     app__present(app_t* app, double alpha);
+static void     app__phase(app_t* app, const char* name);
+static uint64_t app__timeout(app_t* app, uint64_t shown);
+static void     app__wait(app_t* app, uint64_t deadline);
+
+app_t*
+app_create(const app_props_t* props)
+{
+    app_t* app = calloc(1, sizeof(*app));
+
+    if (!app) {
+        loge("Failed to allocate the app");
+        return NULL;
+    }
+
+    window_props_t window_props = props->window;
+
+    app->window = window_create(&window_props);
+    app->input  = app->window ? input_create(app->window) : NULL;
+
+    if (!app->input) {
+        loge("Failed to create the app's window");
+        app_destroy(app);
+        return NULL;
+    }
+
+    /* Updates don't run every frame, nor once, each edge has to reach exactly one */
+    input_set_latched(app->input, true);
+
+    app->timers = timerwheel_create(APP__TIMER_TICK, window_time(app->window));
+
+    if (!app->timers) {
+        app_destroy(app);
+        return NULL;
+    }
+
+    app->user         = props->user;
+    app->update       = props->update;
+    app->render       = props->render;
+    app->submit       = props->submit;
+    app->packet_size  = props->packet_size;
+    app->step         = time_from_sec(1.0 / (props->update_hz > 0.0 ? props->update_hz : APP__UPDATE_HZ));
+    app->max_updates  = props->max_updates ? props->max_updates : APP__MAX_UPDATES;
+    app->slack        = APP__MIN_SLACK;
+    app->redraw       = 1;
+    app->event_driven = props->event_driven;
+
+    if (!app__create_renderer(app, props->render_thread && !window_is_headless(app->window))) {
+        app_destroy(app);
+        return NULL;
+    }
+
+    app_set_fps(app, props->fps);
+
+    return app;
+}
+
+void
+app_destroy(app_t* app)
+{
+    if (!app)
+        return;
+
+    if (app->renderer) {
+        cond_destroy(&app->renderer->ready);
+        mutex_destroy(&app->renderer->lock);
+        free(app->renderer);
+    }
+
+    free(app->packets[0]);
+    free(app->packets[1]);
+    timerwheel_destroy(app->timers);
+    input_destroy(app->input);
+    window_destroy(app->window);
+    free(app);
+}
+
+void
+app_run(app_t* app)
+{
+    atomic_set(&app->running, true);
+    app__start_renderer(app);
+
+    if (app->event_driven)
+        app__run_events(app);
+    else
+        app__run_fixed(app);
+
+    atomic_set(&app->running, false);
+    app__stop_renderer(app);
+}
+
+void
+app_quit(app_t* app)
+{
+    atomic_set(&app->running, false);
+    window_wake(app->window);
+}
+
+void
+app_wake(app_t* app)
+{
+    window_wake(app->window);
+}
+
+void
+app_redraw(app_t* app)
+{
+    atomic_set(&app->redraw, 1);
+    window_wake(app->window);
+}
+
+void
+app_set_fps(app_t* app, double fps)
+{
+    app->period = fps > 0.0 ? time_from_sec(1.0 / fps) : 0;
+
+    window_set_frame_time(app->window, app->period);
+}
+
+
+/* Both packets and the hand-off with a render thread, a single packet without */
+static bool
+app__create_renderer(app_t* app, bool threaded)
+{
+    for (size_t i = 0; app->packet_size && i < (threaded ? 2u : 1u); ++i) {
+        app->packets[i] = calloc(1, app->packet_size);
+
+        if (!app->packets[i]) {
+            loge("Failed to allocate the frame packets");
+            return false;
+        }
+    }
+
+    if (!threaded)
+        return true;
+
+    app->renderer = calloc(1, sizeof(*app->renderer));
+
+    if (!app->renderer) {
+        loge("Failed to allocate the render thread");
+        return false;
+    }
+
+    mutex_init(&app->renderer->lock);
+    cond_init(&app->renderer->ready);
+
+    return true;
+}
+
+/* Falls back to rendering inline if the thread can't be started */
+static void
+app__start_renderer(app_t* app)
+{
+    app__renderer_t* renderer = app->renderer;
+
+    if (!renderer)
+        return;
+
+    renderer->pending = -1;
+    renderer->drawing = -1;
+    renderer->stop    = false;
+
+    /* A context is current on one thread at a time, the render thread keeps it for the whole run */
+    window_set_current(app->window, false);
+    renderer->started = thread_create(&renderer->thread, app__render_main, app);
+
+    if (!renderer->started) {
+        logw("Rendering on the main thread instead");
+        window_set_current(app->window, true);
+    }
+}
+
+/* Lets the render thread draw what was already published, then takes the context back */
+static void
+app__stop_renderer(app_t* app)
+{
+    app__renderer_t* renderer = app->renderer;
+
+    if (!renderer || !renderer->started)
+        return;
+
+    mutex_lock(&renderer->lock);
+    renderer->stop = true;
+    cond_signal(&renderer->ready);
+    mutex_unlock(&renderer->lock);
+
+    thread_join(renderer->thread);
+    renderer->started = false;
+
+    window_set_current(app->window, true);
+}
+
+static void*
+app__render_main(void* arg)
+{
+    app_t* app = arg;
+    app__renderer_t* renderer = app->renderer;
+
+    /* render runs deep GL and user code, its stack overflows should be reported too */
+    crash_thread_init();
+    window_set_current(app->window, true);
+
+    for (;;) {
+        frame_phase("idle");
+
+        mutex_lock(&renderer->lock);
+
+        while (renderer->pending == -1 && !renderer->stop)
+            cond_wait(&renderer->ready, &renderer->lock);
+
+        int draw = renderer->pending;
+        double alpha = draw != -1 ? renderer->alpha[draw] : 0.0;
+
+        renderer->drawing = draw;
+        renderer->pending = -1;
+        cond_signal(&renderer->ready);
+        mutex_unlock(&renderer->lock);
+
+        if (draw == -1)
+            break;
+
+        frame_phase("render");
+        app->packet = app->packets[draw];
+
+        if (app->render) {
+            PROFILE_SCOPE("app_render");
+            app->render(app, alpha);
+        }
+
+        window_flip(app->window);
+
+        mutex_lock(&renderer->lock);
+        renderer->drawing = -1;
+        mutex_unlock(&renderer->lock);
+    }
+
+    window_set_current(app->window, false);
+    crash_thread_shutdown();
+    return NULL;
+}
+
+static void
+app__run_fixed(app_t* app)
+{
+    uint64_t last = window_time(app->window);
+    uint64_t deadline = last;
+    uint64_t accumulator = 0;
+
+    while (atomic_get(&app->running) && window_is_open(app->window)) {
+        /* A headless window's clock only moves when it flips, there's nothing to wait for */
+        if (app->period && !window_is_headless(app->window)) {
+            PROFILE_SCOPE("app_wait");
+            app__phase(app, "idle");
+
+            /* Paced from the previous deadline so a late frame doesn't shift every later one, unless it's a frame or more behind */
+            uint64_t now = time_now();
+            deadline += app->period;
+
+            if (now > deadline + app->period)
+                deadline = now;
+
+            app__wait(app, deadline);
+        }
+
+        uint64_t now = window_time(app->window);
+        accumulator += now - last;
+        last = now;
+
+        timerwheel_advance(app->timers, now);
+
+        app__phase(app, "input");
+        input_poll_events(app->input);
+
+        app__phase(app, "update");
+        unsigned updates = 0;
+
+        while (accumulator >= app->step) {
+            if (updates == app->max_updates) {
+                uint64_t skipped = accumulator / app->step;
+
+                app->dropped += skipped;
+                accumulator  %= app->step;
+
+                log_rate(logw, 1.0, 1, "Running %llu updates behind, skipped them", (unsigned long long)skipped);
+                break;
+            }
+
+            if (app->update) {
+                PROFILE_SCOPE("app_update");
+                app->update(app, time_to_sec(app->step));
+            }
+
+            input_consume(app->input);
+
+            accumulator -= app->step;
+            app->ticks  += 1;
+            updates     += 1;
+        }
+
+        app->alpha = (double)accumulator / (double)app->step;
+        app__present(app, app->alpha);
+    }
+}
+
+static void
+app__run_events(app_t* app)
+{
+    uint64_t last = window_time(app->window);
+    uint64_t shown = 0;     /* When the last redraw was */
+
+    while (atomic_get(&app->running) && window_is_open(app->window)) {
+        app__phase(app, "idle");
+        input_wait_events(app->input, app__timeout(app, shown));
+
+        uint64_t now = window_time(app->window);
+        timerwheel_advance(app->timers, now);
+
+        if (input_event_count(app->input))
+            atomic_set(&app->redraw, 1);
+
+        app__phase(app, "update");
+
+        if (app->update) {
+            PROFILE_SCOPE("app_update");
+            app->update(app, time_to_sec(now - last));
+        }
+
+        input_consume(app->input);
+
+        app->ticks += 1;
+        last = now;
+
+        int dirty = 1;
+
+        if ((!app->period || now - shown >= app->period) && atomic_cas(&app->redraw, &dirty, 0)) {
+            app->alpha = 1.0;
+            shown = now;
+            app__present(app, app->alpha);
+        } else if (window_is_headless(app->window)) {
+            window_flip(app->window);
+        }
+    }
+}
+
+/* Fills the packet and renders it, or hands it to the render thread */
+static void
+app__present(app_t* app, double alpha)
+{
+    app__renderer_t* renderer = app->renderer;
+
+    if (!renderer || !renderer->started) {
+        frame_phase("render");
+
+        if (app->submit)
+            app->submit(app, app->packets[0], alpha);
+
+        app->packet = app->packets[0];
+
+        if (app->render) {
+            PROFILE_SCOPE("app_render");
+            app->render(app, alpha);
+        }
+
+        window_flip(app->window);
+        return;
+    }
+
+    PROFILE_SCOPE("app_submit");
+    mutex_lock(&renderer->lock);
+
+    /* Until the render thread takes the last packet, which keeps the simulation at most a frame ahead */
+    while (renderer->pending != -1)
+        cond_wait(&renderer->ready, &renderer->lock);
+
+    int fill = renderer->drawing == 0 ? 1 : 0;
+    mutex_unlock(&renderer->lock);
+
+    /* Unlocked, the render thread only ever touches the other packet or none */
+    if (app->submit)
+        app->submit(app, app->packets[fill], alpha);
+
+    mutex_lock(&renderer->lock);
+    renderer->alpha[fill] = alpha;
+    renderer->pending = fill;
+    cond_signal(&renderer->ready);
+    mutex_unlock(&renderer->lock);
+}
+
+/* Frame phases belong to the thread that flips */
+static void
+app__phase(app_t* app, const char* name)
+{
+    if (!app->renderer || !app->renderer->started)
+        frame_phase(name);
+}
+
+/* How long the event_driven loop may sleep: until the next redraw the frame rate allows if it's dirty, else the next timer */
+static uint64_t
+app__timeout(app_t* app, uint64_t shown)
+{
+    if (window_is_headless(app->window))
+        return 0;
+
+    uint64_t now = window_time(app->window);
+
+    if (atomic_get(&app->redraw))
+        return app->period && now - shown < app->period ? shown + app->period - now : 0;
+
+    uint64_t next = timerwheel_next_time(app->timers);
+
+    if (next == UINT64_MAX)
+        return UINT64_MAX;
+
+    return next > now ? next - now : 0;
+}
+
+/* Sleeps while oversleeping can't make the frame late, then spins up to the deadline */
+static void
+app__wait(app_t* app, uint64_t deadline)
+{
+    uint64_t now = time_now();
+
+    if (deadline > now + app->slack) {
+        uint64_t requested = deadline - now - app->slack;
+
+        thread_sleep(requested);
+
+        uint64_t slept = time_now() - now;
+        uint64_t late = slept > requested ? slept - requested : 0;
+
+        /* Jumps to the latest wake-up delay plus a margin when it grows, decays slowly back down */
+        if (late + late / 4 > app->slack)
+            app->slack = late + late / 4;
+        else
+            app->slack -= app->slack / 64;
+
+        if (app->slack < APP__MIN_SLACK)
+            app->slack = APP__MIN_SLACK;
+
+        if (app->slack > APP__MAX_SLACK)
+            app->slack = APP__MAX_SLACK;
+    }
+
+    while (time_now() < deadline)
+        ;
+}
@@ -0,0 +1,322 @@
+#define _XOPEN_SOURCE 700 /* sigaction, sigaltstack */
+#include "engine/core/crash.h"
+#include "engine/core/logsink.h"
+
+#if PLATFORM_POSIX
+    #include <signal.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+
+    #if defined(__GLIBC__) || PLATFORM_APPLE
+        #include <execinfo.h>
+        #define CRASH__BACKTRACE 1
+    #endif
+#endif
+
+#include "engine/core/thread.h"
+#include "engine/core/memory.h"
+
+#define CRASH__MAX_FRAMES 64
+#define CRASH__STACK_SIZE (64 * 1024)
+#define CRASH__PATH_SIZE  4096
+
+#if PLATFORM_POSIX
+
+static const int crash__signals[] = {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT, SIGTRAP};
+
+#define CRASH__SIGNALS (sizeof(crash__signals) / sizeof(*crash__signals))
+
+static struct
+{
+    char             path[CRASH__PATH_SIZE];
+    log_sink_t*      ring;
+    bool             installed;
+    volatile int     handling;
+    struct sigaction previous[CRASH__SIGNALS];
+} gCrash;
+
+/* Stack overflows can't run the handler on the stack that overflowed */
+static char crash__stack[CRASH__STACK_SIZE];
+
+/* Of a thread set up by crash_thread_init */
+static THREAD_LOCAL char* crash__thread_stack = NULL;
+
+static void        crash__handler(int sig, siginfo_t* info, void* context);
+static void        crash__report(int fd, int sig, const siginfo_t* info, void** frames, int count);
+static void        crash__puts(int fd, const char* str);
+static void        crash__put_uint(int fd, uint64_t value, unsigned base);
+static const char* crash__signal_name(int sig);
+
+bool
+crash_init(const char* path, log_sink_t* ring)
+{
+    if (strlen(path) >= sizeof(gCrash.path)) {
+        loge("Crash report path is too long: '%s'", path);
+        return false;
+    }
+
+    crash_shutdown();
+
+    strcpy(gCrash.path, path);
+    gCrash.ring = ring;
+
+#if CRASH__BACKTRACE
+    /* The first backtrace loads libgcc and allocates, get that out of the way while it's safe */
+    void* frames[1];
+    backtrace(frames, 1);
+#endif
+
+    stack_t stack = {0};
+    stack.ss_sp   = crash__stack;
+    stack.ss_size = sizeof(crash__stack);
+
+    if (sigaltstack(&stack, NULL) != 0)
+        logw("Failed to set up the crash handler's stack, stack overflows won't be reported");
+
+    struct sigaction action = {0};
+    action.sa_sigaction = crash__handler;
+    action.sa_flags     = SA_SIGINFO | SA_ONSTACK | SA_RESETHAND;
+    sigemptyset(&action.sa_mask);
+
+    for (size_t i = 0; i < CRASH__SIGNALS; ++i) {
+        if (sigaction(crash__signals[i], &action, &gCrash.previous[i]) != 0) {
+            loge("Failed to install the crash handler for %s", crash__signal_name(crash__signals[i]));
+
+            while (i--)
+                sigaction(crash__signals[i], &gCrash.previous[i], NULL);
+
+            return false;
+        }
+    }
+
+    gCrash.installed = true;
+    return true;
+}
+
+void
+crash_shutdown(void)
+{
+    if (!gCrash.installed)
+        return;
+
+    for (size_t i = 0; i < CRASH__SIGNALS; ++i)
+        sigaction(crash__signals[i], &gCrash.previous[i], NULL);
+
+    stack_t stack = {0};
+    stack.ss_flags = SS_DISABLE;
+    sigaltstack(&stack, NULL);
+
+    gCrash.installed = false;
+    gCrash.ring = NULL;
+}
+
+bool
+crash_thread_init(void)
+{
+    if (crash__thread_stack)
+        return true;
+
+    char* memory = malloc(CRASH__STACK_SIZE);
+
+    if (!memory) {
+        logw("Failed to allocate the crash handler's stack, stack overflows on this thread won't be reported");
+        return false;
+    }
+
+    stack_t stack = {0};
+    stack.ss_sp   = memory;
+    stack.ss_size = CRASH__STACK_SIZE;
+
+    if (sigaltstack(&stack, NULL) != 0) {
+        free(memory);
+        logw("Failed to set up the crash handler's stack, stack overflows on this thread won't be reported");
+        return false;
+    }
+
+    crash__thread_stack = memory;
+    return true;
+}
+
+void
+crash_thread_shutdown(void)
+{
+    if (!crash__thread_stack)
+        return;
+
+    stack_t stack = {0};
+    stack.ss_flags = SS_DISABLE;
+    sigaltstack(&stack, NULL);
+
+    free(crash__thread_stack);
+    crash__thread_stack = NULL;
+}
+
+
+static void
+crash__handler(int sig, siginfo_t* info, void* context)
+{
+    UNUSED(context);
+
+    /* SA_RESETHAND already restored the default action for sig, this covers a different signal raised while reporting */
+    if (gCrash.handling) {
+        signal(sig, SIG_DFL);
+        raise(sig);
+        return;
+    }
+
+    gCrash.handling = 1;
+
+    void* frames[CRASH__MAX_FRAMES];
+    int count = 0;
+
+#if CRASH__BACKTRACE
+    count = backtrace(frames, CRASH__MAX_FRAMES);
+#endif
+
+    int fd = open(gCrash.path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd >= 0) {
+        crash__report(fd, sig, info, frames, count);
+        close(fd);
+    }
+
+    crash__report(STDERR_FILENO, sig, info, frames, count);
+
+    if (fd >= 0) {
+        crash__puts(STDERR_FILENO, "Crash report written to ");
+        crash__puts(STDERR_FILENO, gCrash.path);
+        crash__puts(STDERR_FILENO, "\n");
+    }
+
+    /* Blocked until the handler returns, then the default action takes over */
+    raise(sig);
+}
+
+static void
+crash__report(int fd, int sig, const siginfo_t* info, void** frames, int count)
+{
+    crash__puts(fd, "==== Crashed with ");
+    crash__puts(fd, crash__signal_name(sig));
+
+    if (sig == SIGSEGV || sig == SIGBUS || sig == SIGILL || sig == SIGFPE) {
+        crash__puts(fd, " at 0x");
+        crash__put_uint(fd, (uintptr_t)info->si_addr, 16);
+    }
+
+    crash__puts(fd, " ====\n\n---- Backtrace ----\n");
+
+#if CRASH__BACKTRACE
+    backtrace_symbols_fd(frames, count, fd);
+#else
+    UNUSED(frames);
+    UNUSED(count);
+    crash__puts(fd, "(not available on this platform)\n");
+#endif
+
+    crash__puts(fd, "\n---- Unwritten log messages ----\n");
+    log_crash_dump(fd);
+
+    if (gCrash.ring) {
+        crash__puts(fd, "\n---- Last log messages ----\n");
+        logsink_ring_dump(gCrash.ring, fd);
+    }
+
+    memory_stats_t stats;
+    memory_stats(&stats);
+
+    crash__puts(fd, "\n---- Memory ----\nCurrent: ");
+    crash__put_uint(fd, stats.current, 10);
+    crash__puts(fd, " B\nPeak:    ");
+    crash__put_uint(fd, stats.peak, 10);
+    crash__puts(fd, " B\nTotal:   ");
+    crash__put_uint(fd, stats.total, 10);
+    crash__puts(fd, " B\nCalls:   ");
+    crash__put_uint(fd, (uint64_t)stats.mallocs, 10);
+    crash__puts(fd, " malloc, ");
+    crash__put_uint(fd, (uint64_t)stats.callocs, 10);
+    crash__puts(fd, " calloc, ");
+    crash__put_uint(fd, (uint64_t)stats.reallocs, 10);
+    crash__puts(fd, " realloc, ");
+    crash__put_uint(fd, (uint64_t)stats.frees, 10);
+    crash__puts(fd, " free, ");
+    crash__put_uint(fd, (uint64_t)stats.failed, 10);
+    crash__puts(fd, " failed\n");
+}
+
+static void
+crash__puts(int fd, const char* str)
+{
+    size_t len = strlen(str);
+
+    while (len) {
+        ssize_t written = write(fd, str, len);
+
+        if (written <= 0)
+            return;
+
+        str += written;
+        len -= (size_t)written;
+    }
+}
+
+static void
+crash__put_uint(int fd, uint64_t value, unsigned base)
+{
+    char buf[24];
+    size_t i = sizeof(buf);
+
+    buf[--i] = '\0';
+
+    do {
+        buf[--i] = "0123456789abcdef"[value % base];
+        value /= base;
+    } while (value);
+
+    crash__puts(fd, buf + i);
+}
+
+static const char*
+crash__signal_name(int sig)
+{
+    switch (sig)
+    {
+        case SIGSEGV: return "SIGSEGV";
+        case SIGBUS:  return "SIGBUS";
+        case SIGILL:  return "SIGILL";
+        case SIGFPE:  return "SIGFPE";
+        case SIGABRT: return "SIGABRT";
+        case SIGTRAP: return "SIGTRAP";
+    }
+
+    return "unknown signal";
+}
+
+#else /* PLATFORM_POSIX */
+
+bool
+crash_init(const char* path, log_sink_t* ring)
+{
+    UNUSED(path);
+    UNUSED(ring);
+
+    logw("No crash handler on this platform");
+    return false;
+}
+
+void
+crash_shutdown(void)
+{
+}
+
+bool
+crash_thread_init(void)
+{
+    return false;
+}
+
+void
+crash_thread_shutdown(void)
+{
+}
+
+#endif /* PLATFORM_POSIX */
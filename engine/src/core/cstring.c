@@ -1,25 +1,47 @@
 #include "engine/core/cstring.h"
+#include "engine/core/strview.h"
 #include "engine/core/vector.h"
-#include "engine/core/memory.h"
 #include "engine/core/base.h"
+#include "engine/core/log.h"
 
 #include <string.h>
 #include <stdio.h>
 
+#if (COMPILER_GCC || COMPILER_CLANG) && defined(__SSE2__)
+    #include <immintrin.h>
+    #define CSTRING__SSE2 1
+    #define CSTRING__AVX2 1
+    #define CSTRING__TARGET_AVX2 __attribute__((target("avx2")))
+    #define CSTRING__HAS_AVX2() __builtin_cpu_supports("avx2")
+#else
+    #define CSTRING__SSE2 0
+    #define CSTRING__AVX2 0
+#endif
+
+/* After immintrin.h, which declares malloc and free itself */
+#include "engine/core/memory.h"
+
+static char*    strbuf__data(strbuf_t* buf);
+
 string_t
 string_create(const char* c_str)
 {
-    string_t str = NULL;
-    vector_init_with(str, strlen(c_str) + 1);
-    memcpy(str, c_str, strlen(c_str));
-    vector_push(str, '\0');
-    return str;
+    return string_create_n(c_str, strlen(c_str));
 }
 
-void
-string_init(string_t str)
+string_t
+string_create_n(const char* c_str, size_t len)
 {
-    vector_init(str);
+    string_t str = NULL;
+    vector_init_with(str, len + 1);
+
+    if (!str)
+        return NULL;
+
+    memcpy(str, c_str, len);
+    str[len] = '\0';
+    vector_size(str) = len + 1;
+    return str;
 }
 
 void
@@ -31,41 +53,69 @@ string_destroy(string_t str)
 size_t
 string_len(const string_t str)
 {
-    return vector_size(str);
+    return vector_size(str) - 1;
+}
+
+size_t
+string_capacity(const string_t str)
+{
+    return vector_capacity(str) - 1;
 }
 
 void
-string_cat(string_t str1, const string_t str2)
+string_reserve(string_t* str, size_t len)
 {
-    UNUSED(str1); UNUSED(str2);
+    vector_reserve(*str, len + 1);
 }
 
 void
-string_catc(string_t str1, const char* str2)
+string_clear(string_t str)
 {
-    size_t len = strlen(str2) + 1;
-    char* tmp = vector_push_n(str1, len);
+    vector_size(str) = 1;
+    str[0] = '\0';
+}
 
-    tmp[len] = '\0';
+void
+string_cat(string_t* str1, const string_t str2)
+{
+    string_catn(str1, str2, string_len(str2));
+}
 
-    while (len--)
-        tmp[len] = str2[len];
+void
+string_catc(string_t* str1, const char* str2)
+{
+    string_catn(str1, str2, strlen(str2));
 }
 
 void
-string_append(string_t str, const char c)
+string_catn(string_t* str1, const char* str2, size_t len)
 {
-    /* remove the null terminator */
-    UNUSED(vector_pop(str));
+    /* str2 may point into *str1 (e.g. string_cat(&s, s)), which the grow can move */
+    uintptr_t begin = (uintptr_t)*str1;
+    uintptr_t src = (uintptr_t)str2;
+    bool inside = src >= begin && src < begin + vector_size(*str1);
 
-    vector_push(str, c);
-    vector_push(str, '\0');
+    /* push_n grows geometrically, the old null terminator is overwritten */
+    char* dst = vector_push_n(*str1, len) - 1;
+
+    if (inside)
+        str2 = *str1 + (src - begin);
+
+    memmove(dst, str2, len);
+    dst[len] = '\0';
 }
 
 void
-string_copy(string_t dest, const string_t src)
+string_push(string_t* str, char c)
 {
-    UNUSED(dest); UNUSED(src);
+    string_catn(str, &c, 1);
+}
+
+void
+string_copy(string_t* dest, const string_t src)
+{
+    string_clear(*dest);
+    string_catn(dest, src, string_len(src));
 }
 
 int
@@ -77,61 +127,694 @@ string_cmp(const string_t str1, const string_t str2)
 char*
 string_find(const string_t big, const string_t little)
 {
-    return strstr(big, little);
+    return (char*)str_find(big, string_len(big), little, string_len(little));
 }
 
 char*
 string_findc(const string_t big, const char* little)
 {
-    return strstr(big, little);
+    return (char*)str_find(big, string_len(big), little, strlen(little));
 }
 
 bool
-string_replace(string_t str, const char* pattern, const char* with)
+string_replace(string_t* str, const char* pattern, const char* with)
 {
-    UNUSED(str); UNUSED(pattern); UNUSED(with);
-    return false;
+    size_t pattern_len = strlen(pattern);
+    size_t with_len = strlen(with);
+    size_t count = 0;
+
+    if (!pattern_len)
+        return false;
+
+    for (const char* p = strstr(*str, pattern); p; p = strstr(p + pattern_len, pattern))
+        count += 1;
+
+    if (!count)
+        return false;
+
+    /* Build the result in one allocation of the exact size */
+    size_t len = string_len(*str) - count * pattern_len + count * with_len;
+    string_t result = NULL;
+    vector_init_with(result, len + 1);
+
+    if (!result) {
+        loge("Failed to allocate %zu B for string_replace", len + 1);
+        return false;
+    }
+
+    const char* src = *str;
+    char* dst = result;
+
+    for (const char* p = strstr(src, pattern); p; p = strstr(src, pattern)) {
+        memcpy(dst, src, (size_t)(p - src));
+        dst += p - src;
+        memcpy(dst, with, with_len);
+        dst += with_len;
+        src = p + pattern_len;
+    }
+
+    strcpy(dst, src);
+    vector_size(result) = len + 1;
+
+    string_destroy(*str);
+    *str = result;
+    return true;
 }
 
-char** string_tok(const string_t str, const char* delims)
+string_t*
+string_tok(const string_t str, const char* delims)
 {
-    char** tokens = NULL;
-    char* token = strtok (str, delims);
+    string_t* tokens = NULL;
+    strview_tok_t it;
+    strview_t token;
 
     vector_init(tokens);
+    strview_tok_init(&it, strview_from_string(str), delims);
 
-    while (token != NULL)
-    {
-        token = strtok(NULL, delims);
-        vector_push(tokens, token);
-    }
+    while (strview_tok_next(&it, &token))
+        vector_push(tokens, strview_to_string(token));
 
     return tokens;
 }
 
 void
-string_sprintf(string_t str, const char* fmt, ...)
+string_tok_free(string_t* tokens)
 {
-    UNUSED(str); UNUSED(fmt);
+    for (size_t i = 0; i < vector_size(tokens); ++i)
+        string_destroy(tokens[i]);
+
+    vector_free(tokens);
 }
 
 void
-string_toupper(string_t str)
+string_sprintf(string_t* str, const char* fmt, ...)
 {
-    for (size_t i = 0; i < vector_size(str); ++i)
-        str[i] -= 32;
+    va_list ap;
+
+    string_clear(*str);
+
+    va_start(ap, fmt);
+    string_vappendf(str, fmt, ap);
+    va_end(ap);
 }
 
 void
-string_tolower(string_t str)
+string_appendf(string_t* str, const char* fmt, ...)
 {
-    for (size_t i = 0; i < vector_size(str); ++i)
-        str[i] += 32;
+    va_list ap;
+
+    va_start(ap, fmt);
+    string_vappendf(str, fmt, ap);
+    va_end(ap);
+}
+
+void
+string_vappendf(string_t* str, const char* fmt, va_list ap)
+{
+    size_t len = string_len(*str);
+    size_t room = vector_capacity(*str) - len;
+    va_list copy;
+
+    /* Try the spare capacity first, only format twice when it doesn't fit */
+    va_copy(copy, ap);
+    int needed = vsnprintf(*str + len, room, fmt, copy);
+    va_end(copy);
+
+    if (needed < 0) {
+        (*str)[len] = '\0';
+        return;
+    }
+
+    if ((size_t)needed >= room) {
+        (void)vector_push_n(*str, (size_t)needed);
+        vsnprintf(*str + len, (size_t)needed + 1, fmt, ap);
+        return;
+    }
+
+    vector_size(*str) += (size_t)needed;
+}
+
+void
+string_to_upper(string_t str)
+{
+    str_to_upper(str, string_len(str));
+}
+
+void
+string_to_lower(string_t str)
+{
+    str_to_lower(str, string_len(str));
 }
 
 uint32_t
 string_hash(const string_t str)
 {
-    UNUSED(str);
-    return 0;
+    return str_hash32(str, string_len(str), 0);
+}
+
+uint64_t
+string_hash64(const string_t str)
+{
+    return str_hash64(str, string_len(str), 0);
+}
+
+/**************************************************************
+ * Raw buffer primitives
+ */
+
+/* Per byte unsigned (x - lo) < n, done as a signed compare of biased values
+ * since SSE2 and AVX2 have no unsigned byte compares */
+#define CSTRING__IN_RANGE_128(v_, lo_, n_)\
+    _mm_cmplt_epi8(_mm_add_epi8((v_), _mm_set1_epi8((char)(0x80 - (lo_)))), _mm_set1_epi8((char)(0x80 + (n_))))
+
+#define CSTRING__IN_RANGE_256(v_, lo_, n_)\
+    _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(0x80 + (n_))), _mm256_add_epi8((v_), _mm256_set1_epi8((char)(0x80 - (lo_)))))
+
+static bool
+str__in_class(unsigned char c, int cls)
+{
+    switch (cls) {
+        case STR_CLASS_SPACE: return c == ' ' || (unsigned)(c - '\t') < 5;
+        case STR_CLASS_DIGIT: return (unsigned)(c - '0') < 10;
+        case STR_CLASS_ALPHA: return (unsigned)((c | 0x20) - 'a') < 26;
+        case STR_CLASS_ALNUM: return (unsigned)(c - '0') < 10 || (unsigned)((c | 0x20) - 'a') < 26;
+        case STR_CLASS_UPPER: return (unsigned)(c - 'A') < 26;
+        case STR_CLASS_LOWER: return (unsigned)(c - 'a') < 26;
+    }
+
+    return false;
+}
+
+#if CSTRING__SSE2
+
+static inline __m128i
+str__class_128(__m128i v, int cls)
+{
+    switch (cls) {
+        case STR_CLASS_SPACE: return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), CSTRING__IN_RANGE_128(v, '\t', 5));
+        case STR_CLASS_DIGIT: return CSTRING__IN_RANGE_128(v, '0', 10);
+        case STR_CLASS_ALPHA: return CSTRING__IN_RANGE_128(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 26);
+        case STR_CLASS_ALNUM: return _mm_or_si128(CSTRING__IN_RANGE_128(v, '0', 10),
+                                                  CSTRING__IN_RANGE_128(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 26));
+        case STR_CLASS_UPPER: return CSTRING__IN_RANGE_128(v, 'A', 26);
+        case STR_CLASS_LOWER: return CSTRING__IN_RANGE_128(v, 'a', 26);
+    }
+
+    return _mm_setzero_si128();
+}
+
+static size_t
+str__flip_case_sse2(char* str, size_t len, char lo)
+{
+    size_t i = 0;
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(str + i));
+        __m128i mask = CSTRING__IN_RANGE_128(v, lo, 26);
+        _mm_storeu_si128((__m128i*)(str + i), _mm_xor_si128(v, _mm_and_si128(mask, _mm_set1_epi8(0x20))));
+    }
+
+    return i;
+}
+
+static size_t
+str__scan_class_sse2(const char* str, size_t len, int cls, bool want, size_t* found)
+{
+    size_t i = 0;
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(str + i));
+        unsigned mask = (unsigned)_mm_movemask_epi8(str__class_128(v, cls));
+
+        if (!want)
+            mask = ~mask & 0xffff;
+
+        if (mask) {
+            *found = i + (size_t)__builtin_ctz(mask);
+            return i;
+        }
+    }
+
+    return i;
+}
+
+/* Compares the first and last character of the needle against 16 positions at
+ * once, and only runs memcmp where both match */
+static const char*
+str__find_sse2(const char* haystack, size_t haystack_len, const char* needle, size_t needle_len, size_t* i)
+{
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[needle_len - 1]);
+
+    for (; *i + needle_len - 1 + 16 <= haystack_len; *i += 16) {
+        __m128i block_first = _mm_loadu_si128((const __m128i*)(haystack + *i));
+        __m128i block_last = _mm_loadu_si128((const __m128i*)(haystack + *i + needle_len - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block_first, first),
+                                                                  _mm_cmpeq_epi8(block_last, last)));
+
+        while (mask) {
+            size_t at = *i + (size_t)__builtin_ctz(mask);
+
+            if (memcmp(haystack + at + 1, needle + 1, needle_len - 2) == 0)
+                return haystack + at;
+
+            mask &= mask - 1;
+        }
+    }
+
+    return NULL;
+}
+
+#endif /* CSTRING__SSE2 */
+
+#if CSTRING__AVX2
+
+static inline CSTRING__TARGET_AVX2 __m256i
+str__class_256(__m256i v, int cls)
+{
+    switch (cls) {
+        case STR_CLASS_SPACE: return _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), CSTRING__IN_RANGE_256(v, '\t', 5));
+        case STR_CLASS_DIGIT: return CSTRING__IN_RANGE_256(v, '0', 10);
+        case STR_CLASS_ALPHA: return CSTRING__IN_RANGE_256(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 26);
+        case STR_CLASS_ALNUM: return _mm256_or_si256(CSTRING__IN_RANGE_256(v, '0', 10),
+                                                     CSTRING__IN_RANGE_256(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 26));
+        case STR_CLASS_UPPER: return CSTRING__IN_RANGE_256(v, 'A', 26);
+        case STR_CLASS_LOWER: return CSTRING__IN_RANGE_256(v, 'a', 26);
+    }
+
+    return _mm256_setzero_si256();
+}
+
+static CSTRING__TARGET_AVX2 size_t
+str__flip_case_avx2(char* str, size_t len, char lo)
+{
+    size_t i = 0;
+
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(str + i));
+        __m256i mask = CSTRING__IN_RANGE_256(v, lo, 26);
+        _mm256_storeu_si256((__m256i*)(str + i), _mm256_xor_si256(v, _mm256_and_si256(mask, _mm256_set1_epi8(0x20))));
+    }
+
+    return i;
+}
+
+static CSTRING__TARGET_AVX2 size_t
+str__scan_class_avx2(const char* str, size_t len, int cls, bool want, size_t* found)
+{
+    size_t i = 0;
+
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(str + i));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(str__class_256(v, cls));
+
+        if (!want)
+            mask = ~mask;
+
+        if (mask) {
+            *found = i + (size_t)__builtin_ctz(mask);
+            return i;
+        }
+    }
+
+    return i;
+}
+
+static CSTRING__TARGET_AVX2 const char*
+str__find_avx2(const char* haystack, size_t haystack_len, const char* needle, size_t needle_len, size_t* i)
+{
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needle_len - 1]);
+
+    for (; *i + needle_len - 1 + 32 <= haystack_len; *i += 32) {
+        __m256i block_first = _mm256_loadu_si256((const __m256i*)(haystack + *i));
+        __m256i block_last = _mm256_loadu_si256((const __m256i*)(haystack + *i + needle_len - 1));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(block_first, first),
+                                                                        _mm256_cmpeq_epi8(block_last, last)));
+
+        while (mask) {
+            size_t at = *i + (size_t)__builtin_ctz(mask);
+
+            if (memcmp(haystack + at + 1, needle + 1, needle_len - 2) == 0)
+                return haystack + at;
+
+            mask &= mask - 1;
+        }
+    }
+
+    return NULL;
+}
+
+#endif /* CSTRING__AVX2 */
+
+/* Flips the case of every character in [lo, lo + 26) */
+static void
+str__flip_case(char* str, size_t len, char lo)
+{
+    size_t i = 0;
+
+#if CSTRING__AVX2
+    if (CSTRING__HAS_AVX2())
+        i = str__flip_case_avx2(str, len, lo);
+#endif
+#if CSTRING__SSE2
+    i += str__flip_case_sse2(str + i, len - i, lo);
+#endif
+
+    for (; i < len; ++i)
+        if ((unsigned)((unsigned char)str[i] - (unsigned char)lo) < 26)
+            str[i] ^= 0x20;
+}
+
+static size_t
+str__scan_class(const char* str, size_t len, int cls, bool want)
+{
+    size_t i = 0;
+    size_t found = len;
+
+#if CSTRING__AVX2
+    if (CSTRING__HAS_AVX2()) {
+        i = str__scan_class_avx2(str, len, cls, want, &found);
+
+        if (found != len)
+            return found;
+    }
+#endif
+#if CSTRING__SSE2
+    size_t rest = len - i;
+    size_t done = str__scan_class_sse2(str + i, rest, cls, want, &rest);
+
+    if (rest != len - i)
+        return i + rest;
+
+    i += done;
+#endif
+
+    for (; i < len; ++i)
+        if (str__in_class((unsigned char)str[i], cls) == want)
+            return i;
+
+    return len;
+}
+
+void
+str_to_upper(char* str, size_t len)
+{
+    str__flip_case(str, len, 'a');
+}
+
+void
+str_to_lower(char* str, size_t len)
+{
+    str__flip_case(str, len, 'A');
+}
+
+const char*
+str_find(const char* haystack, size_t haystack_len, const char* needle, size_t needle_len)
+{
+    if (!needle_len)
+        return haystack;
+
+    if (needle_len > haystack_len)
+        return NULL;
+
+    if (needle_len == 1)
+        return memchr(haystack, needle[0], haystack_len);
+
+    size_t i = 0;
+    const char* match = NULL;
+
+#if CSTRING__AVX2
+    if (CSTRING__HAS_AVX2() && (match = str__find_avx2(haystack, haystack_len, needle, needle_len, &i)))
+        return match;
+#endif
+#if CSTRING__SSE2
+    if ((match = str__find_sse2(haystack, haystack_len, needle, needle_len, &i)))
+        return match;
+#endif
+
+    for (; i + needle_len <= haystack_len; ++i)
+        if (haystack[i] == needle[0] && memcmp(haystack + i + 1, needle + 1, needle_len - 1) == 0)
+            return haystack + i;
+
+    UNUSED(match);
+    return NULL;
+}
+
+size_t
+str_find_class(const char* str, size_t len, int cls)
+{
+    return str__scan_class(str, len, cls, true);
+}
+
+size_t
+str_skip_class(const char* str, size_t len, int cls)
+{
+    return str__scan_class(str, len, cls, false);
+}
+
+#define STR__PRIME64_1 0x9E3779B185EBCA87ULL
+#define STR__PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define STR__PRIME64_3 0x165667B19E3779F9ULL
+#define STR__PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define STR__PRIME64_5 0x27D4EB2F165667C5ULL
+
+#define STR__ROTL64(x_, r_) (((x_) << (r_)) | ((x_) >> (64 - (r_))))
+
+static inline uint64_t
+str__read64(const unsigned char* p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t
+str__read32(const unsigned char* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t
+str__round64(uint64_t acc, uint64_t input)
+{
+    acc += input * STR__PRIME64_2;
+    acc = STR__ROTL64(acc, 31);
+    return acc * STR__PRIME64_1;
+}
+
+static inline uint64_t
+str__merge64(uint64_t acc, uint64_t val)
+{
+    acc ^= str__round64(0, val);
+    return acc * STR__PRIME64_1 + STR__PRIME64_4;
+}
+
+uint64_t
+str_hash64(const void* data, size_t len, uint64_t seed)
+{
+    const unsigned char* p = data;
+    const unsigned char* end = p + len;
+    uint64_t hash;
+
+    if (len >= 32) {
+        uint64_t v1 = seed + STR__PRIME64_1 + STR__PRIME64_2;
+        uint64_t v2 = seed + STR__PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - STR__PRIME64_1;
+
+        /* Four independent lanes so the multiplies can overlap */
+        for (; p + 32 <= end; p += 32) {
+            v1 = str__round64(v1, str__read64(p));
+            v2 = str__round64(v2, str__read64(p + 8));
+            v3 = str__round64(v3, str__read64(p + 16));
+            v4 = str__round64(v4, str__read64(p + 24));
+        }
+
+        hash = STR__ROTL64(v1, 1) + STR__ROTL64(v2, 7) + STR__ROTL64(v3, 12) + STR__ROTL64(v4, 18);
+        hash = str__merge64(hash, v1);
+        hash = str__merge64(hash, v2);
+        hash = str__merge64(hash, v3);
+        hash = str__merge64(hash, v4);
+    } else {
+        hash = seed + STR__PRIME64_5;
+    }
+
+    hash += (uint64_t)len;
+
+    for (; p + 8 <= end; p += 8) {
+        hash ^= str__round64(0, str__read64(p));
+        hash = STR__ROTL64(hash, 27) * STR__PRIME64_1 + STR__PRIME64_4;
+    }
+
+    if (p + 4 <= end) {
+        hash ^= (uint64_t)str__read32(p) * STR__PRIME64_1;
+        hash = STR__ROTL64(hash, 23) * STR__PRIME64_2 + STR__PRIME64_3;
+        p += 4;
+    }
+
+    for (; p < end; ++p) {
+        hash ^= (uint64_t)(*p) * STR__PRIME64_5;
+        hash = STR__ROTL64(hash, 11) * STR__PRIME64_1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= STR__PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= STR__PRIME64_3;
+    hash ^= hash >> 32;
+
+    return hash;
+}
+
+uint32_t
+str_hash32(const void* data, size_t len, uint32_t seed)
+{
+    uint64_t hash = str_hash64(data, len, seed);
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+/**************************************************************
+ * String builder
+ */
+
+void
+strbuf_init(strbuf_t* buf)
+{
+    buf->len = 0;
+    buf->cap = STRBUF_SMALL - 1;
+    buf->data.small[0] = '\0';
+}
+
+void
+strbuf_free(strbuf_t* buf)
+{
+    if (buf->cap >= STRBUF_SMALL)
+        free(buf->data.heap);
+
+    strbuf_init(buf);
+}
+
+void
+strbuf_clear(strbuf_t* buf)
+{
+    buf->len = 0;
+    strbuf__data(buf)[0] = '\0';
+}
+
+bool
+strbuf_reserve(strbuf_t* buf, size_t len)
+{
+    if (len <= buf->cap)
+        return true;
+
+    size_t cap = buf->cap * 2 > len ? buf->cap * 2 : len;
+    char* heap = NULL;
+
+    if (buf->cap >= STRBUF_SMALL) {
+        heap = realloc(buf->data.heap, cap + 1);
+    } else {
+        heap = malloc(cap + 1);
+
+        if (heap)
+            memcpy(heap, buf->data.small, buf->len + 1);
+    }
+
+    if (!heap) {
+        loge("Failed to grow string buffer to %zu B", cap + 1);
+        return false;
+    }
+
+    buf->data.heap = heap;
+    buf->cap = cap;
+    return true;
+}
+
+size_t
+strbuf_len(const strbuf_t* buf)
+{
+    return buf->len;
+}
+
+const char*
+strbuf_cstr(const strbuf_t* buf)
+{
+    return buf->cap >= STRBUF_SMALL ? buf->data.heap : buf->data.small;
+}
+
+void
+strbuf_append(strbuf_t* buf, const char* str)
+{
+    strbuf_append_n(buf, str, strlen(str));
+}
+
+void
+strbuf_append_n(strbuf_t* buf, const char* str, size_t len)
+{
+    if (!strbuf_reserve(buf, buf->len + len))
+        return;
+
+    char* dst = strbuf__data(buf) + buf->len;
+    memcpy(dst, str, len);
+    dst[len] = '\0';
+    buf->len += len;
+}
+
+void
+strbuf_push(strbuf_t* buf, char c)
+{
+    strbuf_append_n(buf, &c, 1);
+}
+
+void
+strbuf_appendf(strbuf_t* buf, const char* fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    strbuf_vappendf(buf, fmt, ap);
+    va_end(ap);
+}
+
+void
+strbuf_vappendf(strbuf_t* buf, const char* fmt, va_list ap)
+{
+    size_t room = buf->cap - buf->len + 1;
+    va_list copy;
+
+    /* Try the spare capacity first, only format twice when it doesn't fit */
+    va_copy(copy, ap);
+    int needed = vsnprintf(strbuf__data(buf) + buf->len, room, fmt, copy);
+    va_end(copy);
+
+    if (needed < 0) {
+        strbuf__data(buf)[buf->len] = '\0';
+        return;
+    }
+
+    if ((size_t)needed >= room) {
+        if (!strbuf_reserve(buf, buf->len + (size_t)needed)) {
+            strbuf__data(buf)[buf->len] = '\0';
+            return;
+        }
+
+        vsnprintf(strbuf__data(buf) + buf->len, (size_t)needed + 1, fmt, ap);
+    }
+
+    buf->len += (size_t)needed;
+}
+
+string_t
+strbuf_to_string(const strbuf_t* buf)
+{
+    return string_create_n(strbuf_cstr(buf), buf->len);
+}
+
+
+static char*
+strbuf__data(strbuf_t* buf)
+{
+    return buf->cap >= STRBUF_SMALL ? buf->data.heap : buf->data.small;
 }
@@ -0,0 +1,259 @@
+#include "engine/core/flatmap.h"
+#include "engine/core/sort.h"
+#include "engine/core/vector.h"
+#include "engine/core/memory.h"
+#include "engine/core/log.h"
+
+#include <string.h>
+
+static void     flatmap__unfreeze(flatmap_t* map);
+static size_t   flatmap__eytz_build(flatmap_t* map, size_t i, size_t k);
+static size_t   flatmap__eytz_lower_bound(const flatmap_t* map, uint64_t key);
+
+flatmap_t*
+flatmap_create(size_t value_size, size_t capacity)
+{
+    flatmap_t* map = calloc(1, sizeof(*map));
+
+    if (!map) {
+        loge("Failed to create flatmap");
+        return NULL;
+    }
+
+    if (!capacity)
+        capacity = 16;
+
+    map->value_size = value_size;
+    vector_init_with(map->keys, capacity);
+    vector_init_with(map->values, capacity * value_size);
+
+    if (!map->keys || !map->values) {
+        loge("Failed to create flatmap");
+        flatmap_destroy(map);
+        return NULL;
+    }
+
+    return map;
+}
+
+void
+flatmap_destroy(flatmap_t* map)
+{
+    if (!map)
+        return;
+
+    flatmap__unfreeze(map);
+
+    if (map->keys)
+        vector_free(map->keys);
+
+    if (map->values)
+        vector_free(map->values);
+
+    free(map);
+}
+
+size_t
+flatmap_len(const flatmap_t* map)
+{
+    return vector_size(map->keys);
+}
+
+void
+flatmap_clear(flatmap_t* map)
+{
+    flatmap__unfreeze(map);
+    vector_size(map->keys) = 0;
+    vector_size(map->values) = 0;
+}
+
+bool
+flatmap_build(flatmap_t* map, const uint64_t* keys, const void* values, size_t n)
+{
+    flatmap_clear(map);
+
+    if (!n)
+        return true;
+
+    uint32_t* order = malloc(n * sizeof(*order));
+
+    if (!order) {
+        loge("Failed to build flatmap of %zu keys", n);
+        return false;
+    }
+
+    for (size_t i = 0; i < n; ++i)
+        order[i] = (uint32_t)i;
+
+    vector_reserve(map->keys, n);
+    memcpy(map->keys, keys, n * sizeof(*keys));
+
+    /* Stable, so the last of any duplicates ends up last in its run */
+    sort_radix_u64(map->keys, order, n);
+
+    vector_reserve(map->values, n * map->value_size);
+
+    const unsigned char* src = values;
+    size_t len = 0;
+
+    for (size_t i = 0; i < n; ++i) {
+        if (i + 1 < n && map->keys[i] == map->keys[i + 1])
+            continue;
+
+        map->keys[len] = map->keys[i];
+        memcpy(map->values + len * map->value_size,
+               src + (size_t)order[i] * map->value_size,
+               map->value_size);
+        len += 1;
+    }
+
+    vector_size(map->keys) = len;
+    vector_size(map->values) = len * map->value_size;
+
+    free(order);
+    return true;
+}
+
+void*
+flatmap_insert(flatmap_t* map, uint64_t key, const void* value)
+{
+    size_t i = flatmap_lower_bound(map, key);
+    size_t vs = map->value_size;
+
+    if (i == flatmap_len(map) || map->keys[i] != key) {
+        flatmap__unfreeze(map);
+        vector_insert(map->keys, i, key);
+        (void)vector_insert_n(map->values, i * vs, vs);
+    }
+
+    if (value)
+        memcpy(map->values + i * vs, value, vs);
+
+    return map->values + i * vs;
+}
+
+bool
+flatmap_erase(flatmap_t* map, uint64_t key)
+{
+    size_t i = flatmap_lower_bound(map, key);
+
+    if (i == flatmap_len(map) || map->keys[i] != key)
+        return false;
+
+    flatmap__unfreeze(map);
+    vector_delete(map->keys, i);
+    vector_delete_n(map->values, i * map->value_size, map->value_size);
+    return true;
+}
+
+void*
+flatmap_find(const flatmap_t* map, uint64_t key)
+{
+    size_t i = flatmap_lower_bound(map, key);
+
+    if (i == flatmap_len(map) || map->keys[i] != key)
+        return NULL;
+
+    return map->values + i * map->value_size;
+}
+
+bool
+flatmap_contains(const flatmap_t* map, uint64_t key)
+{
+    return flatmap_find(map, key) != NULL;
+}
+
+size_t
+flatmap_lower_bound(const flatmap_t* map, uint64_t key)
+{
+    size_t n = flatmap_len(map);
+
+    if (!n)
+        return 0;
+
+    if (map->eytz_keys)
+        return flatmap__eytz_lower_bound(map, key);
+
+    /* Branchless, the loop always runs log2(n) times and the compare becomes a cmov */
+    const uint64_t* base = map->keys;
+
+    while (n > 1) {
+        size_t half = n >> 1;
+        base = base[half] < key ? base + half : base;
+        n -= half;
+    }
+
+    return (size_t)(base - map->keys) + (*base < key);
+}
+
+uint64_t
+flatmap_key_at(const flatmap_t* map, size_t i)
+{
+    return map->keys[i];
+}
+
+void*
+flatmap_value_at(const flatmap_t* map, size_t i)
+{
+    return map->values + i * map->value_size;
+}
+
+void
+flatmap_freeze(flatmap_t* map)
+{
+    size_t n = flatmap_len(map);
+
+    flatmap__unfreeze(map);
+
+    map->eytz_keys = malloc((n + 1) * sizeof(*map->eytz_keys));
+    map->eytz_index = malloc((n + 1) * sizeof(*map->eytz_index));
+
+    if (!map->eytz_keys || !map->eytz_index) {
+        loge("Failed to freeze flatmap of %zu keys", n);
+        flatmap__unfreeze(map);
+        return;
+    }
+
+    flatmap__eytz_build(map, 0, 1);
+}
+
+
+static void
+flatmap__unfreeze(flatmap_t* map)
+{
+    free(map->eytz_keys);
+    free(map->eytz_index);
+    map->eytz_keys = NULL;
+    map->eytz_index = NULL;
+}
+
+/* Fills the subtree rooted at k with an in-order walk of the sorted keys starting at i */
+static size_t
+flatmap__eytz_build(flatmap_t* map, size_t i, size_t k)
+{
+    if (k > flatmap_len(map))
+        return i;
+
+    i = flatmap__eytz_build(map, i, 2 * k);
+    map->eytz_keys[k] = map->keys[i];
+    map->eytz_index[k] = (uint32_t)i;
+    return flatmap__eytz_build(map, i + 1, 2 * k + 1);
+}
+
+static size_t
+flatmap__eytz_lower_bound(const flatmap_t* map, uint64_t key)
+{
+    const uint64_t* keys = map->eytz_keys;
+    size_t n = flatmap_len(map);
+    size_t k = 1;
+
+    while (k <= n)
+        k = 2 * k + (keys[k] < key);
+
+    /* Undo the right turns taken after the last left turn, which was at the answer */
+    while (k & 1)
+        k >>= 1;
+    k >>= 1;
+
+    return k ? map->eytz_index[k] : n;
+}
@@ -0,0 +1,358 @@
+#include "engine/core/frame.h"
+#include "engine/core/log.h"
+#include "engine/core/timer.h"
+
+#define FRAME__NO_PHASE ((size_t)-1)
+
+/* P² estimator of a single quantile (Jain & Chlamtac, 1985), five markers whatever the sample count */
+typedef struct frame__p2_t
+{
+    uint32_t n;
+    double   p;
+    double   q[5];      /* Marker heights, the first n samples sorted while n < 5 */
+    double   pos[5];    /* Marker positions */
+    double   want[5];   /* Desired marker positions */
+} frame__p2_t;
+
+/* One quantity over the current window */
+typedef struct frame__series_t
+{
+    uint32_t      count;
+    double        min;
+    double        max;
+    double        sum;
+    frame__p2_t   p50;
+    frame__p2_t   p95;
+    frame__p2_t   p99;
+
+    bool          complete;     /* Whether a window has been published yet */
+    frame_stats_t published;
+} frame__series_t;
+
+static struct
+{
+    uint64_t        index;
+    uint64_t        last_end;
+    double          last_ms;
+    double          hitch_ms;
+    frame__series_t total;
+
+    size_t          phase_count;
+    size_t          current;
+    uint64_t        phase_start;
+    const char*     phase_names[FRAME_MAX_PHASES];
+    uint64_t        phase_ns[FRAME_MAX_PHASES];    /* This frame */
+    frame__series_t phases[FRAME_MAX_PHASES];
+
+    float           history[FRAME_HISTORY];
+    uint64_t        history_head;
+
+    frame_hitch_t   hitches[FRAME_MAX_HITCHES];
+    uint64_t        hitch_head;
+} gFrame = {0, 0, 0.0, 50.0, {0}, 0, FRAME__NO_PHASE, 0, {0}, {0}, {{0}}, {0}, 0, {{0}}, 0};
+
+static void   frame__add(frame__series_t* series, double value);
+static void   frame__result(const frame__series_t* series, frame_stats_t* stats);
+static void   frame__current(const frame__series_t* series, frame_stats_t* stats);
+static void   frame__p2_reset(frame__p2_t* p2, double p);
+static void   frame__p2_add(frame__p2_t* p2, double x);
+static double frame__p2_result(const frame__p2_t* p2);
+static void   frame__hitch(double ms);
+
+void
+frame_phase(const char* name)
+{
+    uint64_t now = time_now();
+
+    if (gFrame.current != FRAME__NO_PHASE)
+        gFrame.phase_ns[gFrame.current] += now - gFrame.phase_start;
+
+    size_t i = 0;
+
+    while (i < gFrame.phase_count && strcmp(gFrame.phase_names[i], name) != 0)
+        i += 1;
+
+    if (i == FRAME_MAX_PHASES) {
+        log_once(logw, "Too many frame phases, at most %d are timed", FRAME_MAX_PHASES);
+        gFrame.current = FRAME__NO_PHASE;
+        return;
+    }
+
+    if (i == gFrame.phase_count) {
+        gFrame.phase_names[i] = name;
+        gFrame.phase_count += 1;
+    }
+
+    gFrame.current = i;
+    gFrame.phase_start = now;
+}
+
+void
+frame_end(void)
+{
+    uint64_t now = time_now();
+
+    if (gFrame.current != FRAME__NO_PHASE)
+        gFrame.phase_ns[gFrame.current] += now - gFrame.phase_start;
+
+    gFrame.current = FRAME__NO_PHASE;
+
+    /* The first call only starts the clock */
+    if (gFrame.last_end) {
+        double ms = time_to_ms(now - gFrame.last_end);
+
+        gFrame.index += 1;
+        gFrame.last_ms = ms;
+        gFrame.history[gFrame.history_head++ % FRAME_HISTORY] = (float)ms;
+
+        frame__add(&gFrame.total, ms);
+
+        for (size_t i = 0; i < gFrame.phase_count; ++i)
+            frame__add(&gFrame.phases[i], time_to_ms(gFrame.phase_ns[i]));
+
+        if (gFrame.hitch_ms > 0.0 && ms > gFrame.hitch_ms)
+            frame__hitch(ms);
+    }
+
+    memset(gFrame.phase_ns, 0, sizeof(gFrame.phase_ns));
+    gFrame.last_end = now;
+}
+
+void
+frame_set_hitch(double ms)
+{
+    gFrame.hitch_ms = ms;
+}
+
+uint64_t
+frame_index(void)
+{
+    return gFrame.index;
+}
+
+double
+frame_last_ms(void)
+{
+    return gFrame.last_ms;
+}
+
+void
+frame_stats(frame_stats_t* stats)
+{
+    frame__result(&gFrame.total, stats);
+}
+
+size_t
+frame_phase_count(void)
+{
+    return gFrame.phase_count;
+}
+
+const char*
+frame_phase_name(size_t phase)
+{
+    return phase < gFrame.phase_count ? gFrame.phase_names[phase] : NULL;
+}
+
+void
+frame_phase_stats(size_t phase, frame_stats_t* stats)
+{
+    if (phase < gFrame.phase_count)
+        frame__result(&gFrame.phases[phase], stats);
+    else
+        *stats = (frame_stats_t){0};
+}
+
+size_t
+frame_history(float* out, size_t max)
+{
+    uint64_t count = gFrame.history_head < FRAME_HISTORY ? gFrame.history_head : FRAME_HISTORY;
+
+    if (count > max)
+        count = max;
+
+    for (uint64_t i = 0; i < count; ++i)
+        out[i] = gFrame.history[(gFrame.history_head - count + i) % FRAME_HISTORY];
+
+    return (size_t)count;
+}
+
+size_t
+frame_hitch_count(void)
+{
+    return gFrame.hitch_head < FRAME_MAX_HITCHES ? (size_t)gFrame.hitch_head : FRAME_MAX_HITCHES;
+}
+
+const frame_hitch_t*
+frame_hitch(size_t i)
+{
+    if (i >= frame_hitch_count())
+        return NULL;
+
+    return &gFrame.hitches[(gFrame.hitch_head - 1 - i) % FRAME_MAX_HITCHES];
+}
+
+
+static void
+frame__add(frame__series_t* series, double value)
+{
+    if (!series->count) {
+        series->min = value;
+        series->max = value;
+        series->sum = 0.0;
+
+        frame__p2_reset(&series->p50, 0.50);
+        frame__p2_reset(&series->p95, 0.95);
+        frame__p2_reset(&series->p99, 0.99);
+    }
+
+    series->count += 1;
+    series->sum   += value;
+    series->min    = value < series->min ? value : series->min;
+    series->max    = value > series->max ? value : series->max;
+
+    frame__p2_add(&series->p50, value);
+    frame__p2_add(&series->p95, value);
+    frame__p2_add(&series->p99, value);
+
+    if (series->count == FRAME_WINDOW) {
+        frame__current(series, &series->published);
+        series->complete = true;
+        series->count = 0;
+    }
+}
+
+static void
+frame__result(const frame__series_t* series, frame_stats_t* stats)
+{
+    if (series->complete)
+        *stats = series->published;
+    else
+        frame__current(series, stats);
+}
+
+static void
+frame__current(const frame__series_t* series, frame_stats_t* stats)
+{
+    if (!series->count) {
+        *stats = (frame_stats_t){0};
+        return;
+    }
+
+    stats->min = series->min;
+    stats->avg = series->sum / series->count;
+    stats->max = series->max;
+    stats->p50 = frame__p2_result(&series->p50);
+    stats->p95 = frame__p2_result(&series->p95);
+    stats->p99 = frame__p2_result(&series->p99);
+}
+
+static void
+frame__p2_reset(frame__p2_t* p2, double p)
+{
+    *p2 = (frame__p2_t){0};
+    p2->p = p;
+}
+
+static void
+frame__p2_add(frame__p2_t* p2, double x)
+{
+    /* Until there are five samples the markers are just the samples, kept sorted */
+    if (p2->n < 5) {
+        uint32_t i = p2->n++;
+
+        for (; i > 0 && p2->q[i - 1] > x; --i)
+            p2->q[i] = p2->q[i - 1];
+
+        p2->q[i] = x;
+
+        if (p2->n == 5) {
+            double p = p2->p;
+
+            for (int j = 0; j < 5; ++j)
+                p2->pos[j] = j + 1;
+
+            p2->want[0] = 1.0;
+            p2->want[1] = 1.0 + 2.0 * p;
+            p2->want[2] = 1.0 + 4.0 * p;
+            p2->want[3] = 3.0 + 2.0 * p;
+            p2->want[4] = 5.0;
+        }
+
+        return;
+    }
+
+    const double step[5] = {0.0, p2->p / 2.0, p2->p, (1.0 + p2->p) / 2.0, 1.0};
+    int k;
+
+    if (x < p2->q[0]) {
+        p2->q[0] = x;
+        k = 0;
+    } else if (x >= p2->q[4]) {
+        p2->q[4] = x;
+        k = 3;
+    } else {
+        k = 0;
+
+        while (x >= p2->q[k + 1])
+            k += 1;
+    }
+
+    p2->n += 1;
+
+    for (int i = k + 1; i < 5; ++i)
+        p2->pos[i] += 1.0;
+
+    for (int i = 0; i < 5; ++i)
+        p2->want[i] += step[i];
+
+    /* Moves the middle markers toward their desired positions, parabolically if that keeps them ordered */
+    for (int i = 1; i < 4; ++i) {
+        double d = p2->want[i] - p2->pos[i];
+
+        if ((d >= 1.0 && p2->pos[i + 1] - p2->pos[i] > 1.0) || (d <= -1.0 && p2->pos[i - 1] - p2->pos[i] < -1.0)) {
+            int s = d > 0.0 ? 1 : -1;
+
+            double q = p2->q[i] + s / (p2->pos[i + 1] - p2->pos[i - 1])
+                     * ((p2->pos[i] - p2->pos[i - 1] + s) * (p2->q[i + 1] - p2->q[i]) / (p2->pos[i + 1] - p2->pos[i])
+                      + (p2->pos[i + 1] - p2->pos[i] - s) * (p2->q[i] - p2->q[i - 1]) / (p2->pos[i] - p2->pos[i - 1]));
+
+            if (p2->q[i - 1] < q && q < p2->q[i + 1])
+                p2->q[i] = q;
+            else
+                p2->q[i] += s * (p2->q[i + s] - p2->q[i]) / (p2->pos[i + s] - p2->pos[i]);
+
+            p2->pos[i] += s;
+        }
+    }
+}
+
+static double
+frame__p2_result(const frame__p2_t* p2)
+{
+    if (!p2->n)
+        return 0.0;
+
+    if (p2->n < 5)
+        return p2->q[(uint32_t)(p2->p * (p2->n - 1) + 0.5)];
+
+    return p2->q[2];
+}
+
+static void
+frame__hitch(double ms)
+{
+    frame_hitch_t* hitch = &gFrame.hitches[gFrame.hitch_head++ % FRAME_MAX_HITCHES];
+
+    profile_release(hitch->profile);
+
+    hitch->index = gFrame.index;
+    hitch->ms    = ms;
+
+    /* profile_frame has aggregated this frame by now, window_flip calls it first */
+    const profile_frame_t* profile = profile_last();
+    hitch->profile = PROFILE_ENABLED && profile->count ? profile_capture(profile) : NULL;
+
+    log_rate(logw, 1.0, 5, "Frame %llu took %.2f ms, over the %.2f ms hitch threshold",
+             (unsigned long long)hitch->index, ms, gFrame.hitch_ms);
+}
@@ -0,0 +1,375 @@
+#include "engine/core/heap.h"
+#include "engine/core/vector.h"
+#include "engine/core/memory.h"
+#include "engine/core/log.h"
+
+#include <string.h>
+
+#define HEAP__AT(h_, i_) ((unsigned char*)(h_) + (i_) * type_size)
+
+static void pqueue__sift_up(pqueue_t* queue, size_t i);
+static void pqueue__sift_down(pqueue_t* queue, size_t i);
+static void pqueue__reserve_id(pqueue_t* queue, uint32_t id);
+
+/**************************************************************
+ * Generic heap
+ */
+
+/* Moves the hole at index i up until val fits in it, the hole is filled with val */
+static size_t
+heap__hole_up(void* h, size_t i, const void* val, size_t type_size,
+              int (*cmp)(const void*, const void*))
+{
+    while (i > 0) {
+        size_t parent = (i - 1) / HEAP_ARITY;
+
+        if (cmp(val, HEAP__AT(h, parent)) >= 0)
+            break;
+
+        memcpy(HEAP__AT(h, i), HEAP__AT(h, parent), type_size);
+        i = parent;
+    }
+
+    memcpy(HEAP__AT(h, i), val, type_size);
+    return i;
+}
+
+/* Moves the hole at index i down until val fits in it, the hole is filled with val */
+static size_t
+heap__hole_down(void* h, size_t n, size_t i, const void* val, size_t type_size,
+                int (*cmp)(const void*, const void*))
+{
+    for (;;) {
+        size_t first = i * HEAP_ARITY + 1;
+
+        if (first >= n)
+            break;
+
+        size_t last = first + HEAP_ARITY < n ? first + HEAP_ARITY : n;
+        size_t best = first;
+
+        for (size_t c = first + 1; c < last; ++c)
+            if (cmp(HEAP__AT(h, c), HEAP__AT(h, best)) < 0)
+                best = c;
+
+        if (cmp(HEAP__AT(h, best), val) >= 0)
+            break;
+
+        memcpy(HEAP__AT(h, i), HEAP__AT(h, best), type_size);
+        i = best;
+    }
+
+    memcpy(HEAP__AT(h, i), val, type_size);
+    return i;
+}
+
+void
+heap__sift_up(void* h, size_t i, size_t type_size, int (*cmp)(const void*, const void*))
+{
+    unsigned char val[type_size];
+    memcpy(val, HEAP__AT(h, i), type_size);
+    heap__hole_up(h, i, val, type_size, cmp);
+}
+
+void
+heap__pop(void* h, size_t n, size_t type_size, int (*cmp)(const void*, const void*))
+{
+    if (n < 2)
+        return;
+
+    /* The old root ends up at n - 1, right past the end of the shrunk heap */
+    unsigned char val[type_size];
+    memcpy(val, HEAP__AT(h, n - 1), type_size);
+    memcpy(HEAP__AT(h, n - 1), HEAP__AT(h, 0), type_size);
+    heap__hole_down(h, n - 1, 0, val, type_size, cmp);
+}
+
+void
+heap__update(void* h, size_t n, size_t i, size_t type_size, int (*cmp)(const void*, const void*))
+{
+    if (i >= n)
+        return;
+
+    unsigned char val[type_size];
+    memcpy(val, HEAP__AT(h, i), type_size);
+
+    if (heap__hole_up(h, i, val, type_size, cmp) == i)
+        heap__hole_down(h, n, i, val, type_size, cmp);
+}
+
+void
+heap__heapify(void* h, size_t n, size_t type_size, int (*cmp)(const void*, const void*))
+{
+    if (n < 2)
+        return;
+
+    unsigned char val[type_size];
+
+    for (size_t i = (n - 2) / HEAP_ARITY + 1; i-- > 0; ) {
+        memcpy(val, HEAP__AT(h, i), type_size);
+        heap__hole_down(h, n, i, val, type_size, cmp);
+    }
+}
+
+/**************************************************************
+ * Indexed priority queue
+ */
+
+pqueue_t*
+pqueue_create(size_t capacity)
+{
+    pqueue_t* queue = malloc(sizeof(*queue));
+
+    if (!queue) {
+        loge("Failed to create priority queue");
+        return NULL;
+    }
+
+    vector_init_with(queue->nodes, capacity ? capacity : 16);
+    vector_init_with(queue->slots, capacity ? capacity : 16);
+
+    if (!queue->nodes || !queue->slots) {
+        loge("Failed to create priority queue");
+        pqueue_destroy(queue);
+        return NULL;
+    }
+
+    return queue;
+}
+
+void
+pqueue_destroy(pqueue_t* queue)
+{
+    if (!queue)
+        return;
+
+    if (queue->nodes)
+        vector_free(queue->nodes);
+
+    if (queue->slots)
+        vector_free(queue->slots);
+
+    free(queue);
+}
+
+size_t
+pqueue_len(const pqueue_t* queue)
+{
+    return vector_size(queue->nodes);
+}
+
+bool
+pqueue_empty(const pqueue_t* queue)
+{
+    return vector_empty(queue->nodes);
+}
+
+void
+pqueue_clear(pqueue_t* queue)
+{
+    for (size_t i = 0; i < vector_size(queue->nodes); ++i)
+        queue->slots[queue->nodes[i].id] = PQUEUE_NONE;
+
+    vector_size(queue->nodes) = 0;
+}
+
+bool
+pqueue_contains(const pqueue_t* queue, uint32_t id)
+{
+    return id < vector_size(queue->slots) && queue->slots[id] != PQUEUE_NONE;
+}
+
+double
+pqueue_priority(const pqueue_t* queue, uint32_t id)
+{
+    if (!pqueue_contains(queue, id))
+        return 0.0;
+
+    return queue->nodes[queue->slots[id]].priority;
+}
+
+void
+pqueue_push(pqueue_t* queue, uint32_t id, double priority)
+{
+    if (id == PQUEUE_NONE) {
+        logw("Tried to push the reserved id PQUEUE_NONE");
+        return;
+    }
+
+    if (pqueue_contains(queue, id)) {
+        size_t i = queue->slots[id];
+        double old = queue->nodes[i].priority;
+
+        queue->nodes[i].priority = priority;
+
+        if (priority < old)
+            pqueue__sift_up(queue, i);
+        else
+            pqueue__sift_down(queue, i);
+
+        return;
+    }
+
+    pqueue__reserve_id(queue, id);
+
+    vector_push(queue->nodes, ((pqueue_node_t){priority, id}));
+    queue->slots[id] = (uint32_t)(vector_size(queue->nodes) - 1);
+    pqueue__sift_up(queue, vector_size(queue->nodes) - 1);
+}
+
+bool
+pqueue_decrease(pqueue_t* queue, uint32_t id, double priority)
+{
+    if (!pqueue_contains(queue, id))
+        return false;
+
+    size_t i = queue->slots[id];
+
+    if (!(priority < queue->nodes[i].priority))
+        return false;
+
+    queue->nodes[i].priority = priority;
+    pqueue__sift_up(queue, i);
+    return true;
+}
+
+bool
+pqueue_remove(pqueue_t* queue, uint32_t id)
+{
+    if (!pqueue_contains(queue, id))
+        return false;
+
+    size_t i = queue->slots[id];
+    size_t last = vector_size(queue->nodes) - 1;
+
+    queue->slots[id] = PQUEUE_NONE;
+    vector_size(queue->nodes) = last;
+
+    if (i == last)
+        return true;
+
+    double old = queue->nodes[i].priority;
+
+    queue->nodes[i] = queue->nodes[last];
+    queue->slots[queue->nodes[i].id] = (uint32_t)i;
+
+    if (queue->nodes[i].priority < old)
+        pqueue__sift_up(queue, i);
+    else
+        pqueue__sift_down(queue, i);
+
+    return true;
+}
+
+uint32_t
+pqueue_peek(const pqueue_t* queue, double* priority)
+{
+    if (vector_empty(queue->nodes))
+        return PQUEUE_NONE;
+
+    if (priority)
+        *priority = queue->nodes[0].priority;
+
+    return queue->nodes[0].id;
+}
+
+uint32_t
+pqueue_pop(pqueue_t* queue, double* priority)
+{
+    uint32_t id = pqueue_peek(queue, priority);
+
+    if (id != PQUEUE_NONE)
+        pqueue_remove(queue, id);
+
+    return id;
+}
+
+void
+pqueue_heapify(pqueue_t* queue, const uint32_t* ids, const double* priorities, size_t n)
+{
+    pqueue_clear(queue);
+    vector_reserve(queue->nodes, n);
+
+    for (size_t i = 0; i < n; ++i) {
+        pqueue__reserve_id(queue, ids[i]);
+        queue->nodes[i] = (pqueue_node_t){priorities[i], ids[i]};
+        queue->slots[ids[i]] = (uint32_t)i;
+    }
+
+    vector_size(queue->nodes) = n;
+
+    if (n < 2)
+        return;
+
+    for (size_t i = (n - 2) / HEAP_ARITY + 1; i-- > 0; )
+        pqueue__sift_down(queue, i);
+}
+
+
+/* The queue's sifts are specialized instead of going through heap__*, since
+ * every move also has to update the slot of the moved id */
+
+static void
+pqueue__sift_up(pqueue_t* queue, size_t i)
+{
+    pqueue_node_t* nodes = queue->nodes;
+    pqueue_node_t node = nodes[i];
+
+    while (i > 0) {
+        size_t parent = (i - 1) / HEAP_ARITY;
+
+        if (!(node.priority < nodes[parent].priority))
+            break;
+
+        nodes[i] = nodes[parent];
+        queue->slots[nodes[i].id] = (uint32_t)i;
+        i = parent;
+    }
+
+    nodes[i] = node;
+    queue->slots[node.id] = (uint32_t)i;
+}
+
+static void
+pqueue__sift_down(pqueue_t* queue, size_t i)
+{
+    pqueue_node_t* nodes = queue->nodes;
+    pqueue_node_t node = nodes[i];
+    size_t n = vector_size(nodes);
+
+    for (;;) {
+        size_t first = i * HEAP_ARITY + 1;
+
+        if (first >= n)
+            break;
+
+        size_t last = first + HEAP_ARITY < n ? first + HEAP_ARITY : n;
+        size_t best = first;
+
+        for (size_t c = first + 1; c < last; ++c)
+            if (nodes[c].priority < nodes[best].priority)
+                best = c;
+
+        if (!(nodes[best].priority < node.priority))
+            break;
+
+        nodes[i] = nodes[best];
+        queue->slots[nodes[i].id] = (uint32_t)i;
+        i = best;
+    }
+
+    nodes[i] = node;
+    queue->slots[node.id] = (uint32_t)i;
+}
+
+static void
+pqueue__reserve_id(pqueue_t* queue, uint32_t id)
+{
+    size_t size = vector_size(queue->slots);
+
+    if (id < size)
+        return;
+
+    uint32_t* slots = vector_push_n(queue->slots, id + 1 - size);
+    memset(slots, 0xff, (id + 1 - size) * sizeof(*slots));
+}
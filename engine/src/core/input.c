@@ -2,14 +2,42 @@
 #include "engine/graphics/window.h"
 #include "engine/core/memory.h"
 #include "engine/core/log.h"
+#include "engine/core/profile.h"
+#include "engine/core/timer.h"
+#include "engine/core/vector.h"
 #include "engine/core/base.h" /* UNUSED macro */
 
 #include "GLFW/glfw3.h"
 
-static void input__refresh(input_t* input);
+#include <stdio.h>
 
-static input_button_t input__get_key(const input_t* input, int key);
-static input_button_t input__get_button(const input_t* input, int button);
+/* A binding compiled down to the bit it tests */
+struct input__bound_t
+{
+    uint64_t mask;
+    uint16_t word;
+    uint8_t  type;
+    uint8_t  mods;
+    uint16_t action;
+    float    scale;
+};
+
+static void input__batch(input_t* input, uint64_t timeout_ns);
+static void input__refresh(input_t* input);
+static void input__push(input_t* input, input_event_t event);
+static void input__apply(input_t* input, const input_event_t* event);
+static void input__actions_update(input_t* input, bool keep);
+static uint8_t input__mods(const input_t* input);
+static uint8_t input__action(int action);
+static bool input__has_action(const input_t* input, int action);
+static void input__record(input_t* input, uint64_t from);
+static void input__replay(input_t* input);
+static bool input__replay_batch(input_t* input, FILE* file);
+static size_t input__put_varint(uint8_t* buf, uint64_t value);
+static bool input__get_varint(FILE* file, uint64_t* value);
+
+static bool input__has_key(const input_t* input, int key);
+static bool input__has_button(const input_t* input, int button);
 
 /* GLFW callbacks */
 static void input__on_key(GLFWwindow* window, int key, int scancode, int action, int mods);
@@ -28,6 +56,12 @@ input_create(const window_t* window)
         return NULL;
     }
 
+    /* A headless window has no events of its own, only replays feed it */
+    input->window = window && !window_is_headless(window) ? window : NULL;
+
+    if (!input->window)
+        return input;
+
     /* So input can be accessed from the callbacks */
     glfwSetWindowUserPointer(window->window, input);
 
@@ -45,53 +79,323 @@ input_destroy(input_t* input)
     if (!input)
         return;
 
+    input_record_stop(input);
+    input_replay_stop(input);
+
+    if (input->actions.bound)
+        vector_free(input->actions.bound);
+
     free(input);
 }
 
 void
-input_poll_events(input_t* input)
+input_set_latched(input_t* input, bool latched)
+{
+    if (!input)
+        return;
+
+    input->latched = latched;
+}
+
+void
+input_consume(input_t* input)
 {
     if (!input)
         return;
 
     input__refresh(input);
-    glfwPollEvents();
+}
+
+void
+input_poll_events(input_t* input)
+{
+    PROFILE_FUNCTION();
+
+    if (!input)
+        return;
+
+    input__batch(input, 0);
+}
+
+void
+input_wait_events(input_t* input, uint64_t timeout_ns)
+{
+    PROFILE_FUNCTION();
+
+    if (!input)
+        return;
+
+    input__batch(input, timeout_ns);
+}
+
+size_t
+input_event_count(const input_t* input)
+{
+    if (!input)
+        return 0;
+
+    return (size_t)(input->stream.end - input->stream.begin);
+}
+
+const input_event_t*
+input_event(const input_t* input, size_t i)
+{
+    if (i >= input_event_count(input))
+        return NULL;
+
+    return &input->stream.events[(input->stream.begin + i) & (INPUT_EVENT_CAPACITY - 1)];
 }
 
 bool
 input_key_down(const input_t* input, int key)
 {
-    return input__get_key(input, key).down;
+    return input__has_key(input, key) && (input->keyboard.down[key >> 6] >> (key & 63) & 1);
 }
 
 bool
 input_key_pressed(const input_t* input, int key)
 {
-    return input__get_key(input, key).pressed;
+    return input__has_key(input, key) && (input->keyboard.pressed[key >> 6] >> (key & 63) & 1);
 }
 
 bool
 input_key_released(const input_t* input, int key)
 {
-    return input__get_key(input, key).released;
+    return input__has_key(input, key) && (input->keyboard.released[key >> 6] >> (key & 63) & 1);
+}
+
+bool
+input_key_any_pressed(const input_t* input)
+{
+    if (!input)
+        return false;
+
+    for (size_t i = 0; i < input->keyboard.changed_count; ++i) {
+        int key = input->keyboard.changed[i];
+
+        if (input->keyboard.pressed[key >> 6] & (1ULL << (key & 63)))
+            return true;
+    }
+
+    return false;
+}
+
+size_t
+input_key_changed_count(const input_t* input)
+{
+    if (!input)
+        return 0;
+
+    return input->keyboard.changed_count;
+}
+
+int
+input_key_changed(const input_t* input, size_t i)
+{
+    if (i >= input_key_changed_count(input))
+        return KEY_UNKNOWN;
+
+    return input->keyboard.changed[i];
+}
+
+int
+input_action(input_t* input, const char* name)
+{
+    strid_t id = intern_string(name);
+
+    for (size_t i = 0; i < input->actions.count; ++i)
+        if (input->actions.list[i].name == id)
+            return (int)i;
+
+    if (input->actions.count == INPUT_MAX_ACTIONS) {
+        loge("Too many input actions, can't add '%s', at most %d are supported", name, INPUT_MAX_ACTIONS);
+        return -1;
+    }
+
+    input->actions.list[input->actions.count] = (input_action_t){id, 0.0f, 0, 0, 0};
+
+    return (int)input->actions.count++;
+}
+
+bool
+input_action_bind(input_t* input, int action, input_binding_t binding)
+{
+    if (!input__has_action(input, action))
+        return false;
+
+    uint8_t mods = binding.mods & (MOD_SHIFT | MOD_CONTROL | MOD_ALT | MOD_SUPER);
+    input__bound_t bound = {0, 0, binding.type, mods, (uint16_t)action, binding.scale};
+
+    switch (binding.type) {
+        case INPUT_BIND_KEY: {
+            if (binding.code >= KEY_LAST) {
+                loge("Can't bind key %d, it's out of range", binding.code);
+                return false;
+            }
+
+            bound.word = binding.code >> 6;
+            bound.mask = 1ULL << (binding.code & 63);
+        } break;
+
+        case INPUT_BIND_BUTTON: {
+            if (binding.code >= MOUSE_BUTTON_LAST) {
+                loge("Can't bind mouse button %d, it's out of range", binding.code);
+                return false;
+            }
+
+            bound.mask = 1ULL << binding.code;
+        } break;
+
+        case INPUT_BIND_SCROLL_X:
+        case INPUT_BIND_SCROLL_Y: {
+        } break;
+
+        default: {
+            loge("Unknown binding type %d", binding.type);
+            return false;
+        }
+    }
+
+    if (!input->actions.bound)
+        vector_init(input->actions.bound);
+
+    vector_push(input->actions.bound, bound);
+    return true;
+}
+
+void
+input_action_unbind(input_t* input, int action)
+{
+    if (!input__has_action(input, action) || !input->actions.bound)
+        return;
+
+    size_t kept = 0;
+
+    for (size_t i = 0; i < vector_size(input->actions.bound); ++i)
+        if (input->actions.bound[i].action != action)
+            input->actions.bound[kept++] = input->actions.bound[i];
+
+    vector_size(input->actions.bound) = kept;
+}
+
+bool
+input_action_down(const input_t* input, int action)
+{
+    return input__has_action(input, action) && input->actions.list[action].down;
+}
+
+bool
+input_action_pressed(const input_t* input, int action)
+{
+    return input__has_action(input, action) && input->actions.list[action].pressed;
+}
+
+bool
+input_action_released(const input_t* input, int action)
+{
+    return input__has_action(input, action) && input->actions.list[action].released;
+}
+
+float
+input_action_value(const input_t* input, int action)
+{
+    return input__has_action(input, action) ? input->actions.list[action].value : 0.0f;
+}
+
+bool
+input_record_start(input_t* input, const char* path)
+{
+    input_record_stop(input);
+
+    FILE* file = fopen(path, "wb");
+
+    if (!file) {
+        loge("Failed to open input recording '%s'", path);
+        return false;
+    }
+
+    fwrite(INPUT_RECORD_MAGIC, 1, sizeof(INPUT_RECORD_MAGIC) - 1, file);
+
+    input->recording.record      = file;
+    input->recording.record_time = time_now();
+    input->recording.frames      = 0;
+
+    return true;
+}
+
+void
+input_record_stop(input_t* input)
+{
+    if (!input || !input->recording.record)
+        return;
+
+    if (fclose(input->recording.record) != 0)
+        loge("Failed to finish the input recording");
+    else
+        logi("Recorded %llu frames of input", (unsigned long long)input->recording.frames);
+
+    input->recording.record = NULL;
+}
+
+bool
+input_replay_start(input_t* input, const char* path)
+{
+    input_replay_stop(input);
+
+    FILE* file = fopen(path, "rb");
+
+    if (!file) {
+        loge("Failed to open input recording '%s'", path);
+        return false;
+    }
+
+    char magic[sizeof(INPUT_RECORD_MAGIC) - 1];
+
+    if (fread(magic, 1, sizeof(magic), file) != sizeof(magic) || memcmp(magic, INPUT_RECORD_MAGIC, sizeof(magic)) != 0) {
+        loge("'%s' isn't an input recording", path);
+        fclose(file);
+        return false;
+    }
+
+    input->recording.replay      = file;
+    input->recording.replay_time = time_now();
+    input->recording.frames      = 0;
+
+    return true;
+}
+
+void
+input_replay_stop(input_t* input)
+{
+    if (!input || !input->recording.replay)
+        return;
+
+    fclose(input->recording.replay);
+    input->recording.replay = NULL;
+}
+
+bool
+input_is_replaying(const input_t* input)
+{
+    return input && input->recording.replay;
 }
 
 bool
 input_mouse_down(const input_t* input, int button)
 {
-    return input__get_button(input, button).down;
+    return input__has_button(input, button) && (input->mouse.down >> button & 1);
 }
 
 bool
 input_mouse_pressed(const input_t* input, int button)
 {
-    return input__get_button(input, button).pressed;
+    return input__has_button(input, button) && (input->mouse.pressed >> button & 1);
 }
 
 bool
 input_mouse_released(const input_t* input, int button)
 {
-    return input__get_button(input, button).released;
+    return input__has_button(input, button) && (input->mouse.released >> button & 1);
 }
 
 float
@@ -148,69 +452,403 @@ input_mouse_set_trapped(input_t* input, bool trapped)
     input->mouse.is_trapped = trapped;
 }
 
+
+/* Starts a batch, pumps the OS events, waiting up to timeout_ns for one, and applies them */
+static void
+input__batch(input_t* input, uint64_t timeout_ns)
+{
+    if (!input->latched)
+        input__refresh(input);
+
+    /* Pumped during a replay as well, to keep the window responsive, the callbacks drop the events */
+    if (input->window) {
+        /* Doesn't block on events already waiting, nor during a replay, whose batches are due every frame */
+        if (!timeout_ns || input->recording.replay || input->stream.begin != input->stream.head)
+            glfwPollEvents();
+        else if (timeout_ns == UINT64_MAX)
+            glfwWaitEvents();
+        else
+            glfwWaitEventsTimeout(time_to_sec(timeout_ns));
+    }
+
+    if (input->recording.replay)
+        input__replay(input);
+
+    /* Anything that arrived since the last poll is new too, unless it was pushed out of the batch */
+    uint64_t from = input->stream.end > input->stream.begin ? input->stream.end : input->stream.begin;
+
+    for (uint64_t i = from; i < input->stream.head; ++i)
+        input__apply(input, &input->stream.events[i & (INPUT_EVENT_CAPACITY - 1)]);
+
+    input->stream.end = input->stream.head;
+
+    if (input->recording.record)
+        input__record(input, from);
+
+    input__actions_update(input, input->latched);
+}
+
+/* Only the keys that changed last frame have bits to clear */
 static void
 input__refresh(input_t* input)
 {
     if (!input)
         return;
 
-    for (int i = 0; i < KEY_LAST; ++i)
-    {
-        input->keyboard.keys[i].pressed = 0;
-        input->keyboard.keys[i].released = 0;
+    for (size_t i = 0; i < input->keyboard.changed_count; ++i) {
+        int key = input->keyboard.changed[i];
+
+        input->keyboard.pressed[key >> 6]  &= ~(1ULL << (key & 63));
+        input->keyboard.released[key >> 6] &= ~(1ULL << (key & 63));
     }
 
-    for (int i = 0; i < MOUSE_BUTTON_LAST; ++i)
-    {
-        input->mouse.buttons[i].pressed = 0;
-        input->mouse.buttons[i].released = 0;
+    input->keyboard.changed_count = 0;
+
+    input->mouse.pressed  = 0;
+    input->mouse.released = 0;
+    input->mouse.xscroll  = 0;
+    input->mouse.yscroll  = 0;
+
+    for (size_t i = 0; i < input->actions.count; ++i) {
+        input->actions.list[i].pressed  = false;
+        input->actions.list[i].released = false;
     }
 
-    input->mouse.xscroll = 0;
-    input->mouse.yscroll = 0;
+    /* Anything that arrives from now on belongs to the next batch */
+    input->stream.begin = input->stream.end;
+}
+
+static bool
+input__has_key(const input_t* input, int key)
+{
+    return input && key >= 0 && key < KEY_LAST;
 }
 
-static input_button_t
-input__get_key(const input_t* input, int key)
+static bool
+input__has_button(const input_t* input, int button)
 {
-    if (!input || key < 0 || key >= KEY_LAST)
-        return (input_button_t){0};
+    return input && button >= 0 && button < MOUSE_BUTTON_LAST;
+}
 
-    return input->keyboard.keys[key];
+static bool
+input__has_action(const input_t* input, int action)
+{
+    return input && action >= 0 && (size_t)action < input->actions.count;
 }
 
-static input_button_t
-input__get_button(const input_t* input, int button)
+/* One pass over the compiled bindings, then pressed and released fall out of the previous frame's down */
+/* With keep, edges from earlier polls that weren't consumed yet stay set */
+static void
+input__actions_update(input_t* input, bool keep)
 {
-    if (!input || button < 0 || button >= MOUSE_BUTTON_LAST)
-        return (input_button_t){0};
+    size_t count = input->actions.count;
+    size_t bound_count = input->actions.bound ? vector_size(input->actions.bound) : 0;
+    bool   was_down[INPUT_MAX_ACTIONS];
+    bool   tapped[INPUT_MAX_ACTIONS];
+    uint8_t mods = input__mods(input);
+
+    for (size_t i = 0; i < count; ++i) {
+        was_down[i] = input->actions.list[i].down;
+        tapped[i] = false;
+
+        input->actions.list[i].value = 0.0f;
+        input->actions.list[i].down  = false;
+    }
+
+    for (size_t i = 0; i < bound_count; ++i) {
+        const input__bound_t* bound = &input->actions.bound[i];
+        input_action_t* action = &input->actions.list[bound->action];
+
+        if (bound->mods && bound->mods != mods)
+            continue;
+
+        float amount = 0.0f;
+        bool  held = false;
+
+        switch (bound->type) {
+            case INPUT_BIND_KEY: {
+                held = input->keyboard.down[bound->word] & bound->mask;
+                tapped[bound->action] |= (input->keyboard.pressed[bound->word] & bound->mask) != 0;
+                amount = bound->scale;
+            } break;
+
+            case INPUT_BIND_BUTTON: {
+                held = input->mouse.down & bound->mask;
+                tapped[bound->action] |= (input->mouse.pressed & bound->mask) != 0;
+                amount = bound->scale;
+            } break;
+
+            case INPUT_BIND_SCROLL_X: {
+                held = input->mouse.xscroll != 0.0f;
+                amount = bound->scale * input->mouse.xscroll;
+            } break;
+
+            case INPUT_BIND_SCROLL_Y: {
+                held = input->mouse.yscroll != 0.0f;
+                amount = bound->scale * input->mouse.yscroll;
+            } break;
+
+            default: {
+            } break;
+        }
+
+        if (held) {
+            action->value += amount;
+            action->down = true;
+        }
+    }
+
+    /* A key pressed and released within the frame is never down, but still presses and releases the action */
+    for (size_t i = 0; i < count; ++i) {
+        input_action_t* action = &input->actions.list[i];
 
-    return input->mouse.buttons[button];
+        bool pressed  = !was_down[i] && (action->down || tapped[i]);
+        bool released = (was_down[i] || tapped[i]) && !action->down;
+
+        action->pressed  = pressed  || (keep && action->pressed);
+        action->released = released || (keep && action->released);
+    }
+}
+
+static uint8_t
+input__mods(const input_t* input)
+{
+    uint8_t mods = 0;
+
+    if (input_key_down(input, KEY_LEFT_SHIFT) || input_key_down(input, KEY_RIGHT_SHIFT))
+        mods |= MOD_SHIFT;
+
+    if (input_key_down(input, KEY_LEFT_CONTROL) || input_key_down(input, KEY_RIGHT_CONTROL))
+        mods |= MOD_CONTROL;
+
+    if (input_key_down(input, KEY_LEFT_ALT) || input_key_down(input, KEY_RIGHT_ALT))
+        mods |= MOD_ALT;
+
+    if (input_key_down(input, KEY_LEFT_SUPER) || input_key_down(input, KEY_RIGHT_SUPER))
+        mods |= MOD_SUPER;
+
+    return mods;
 }
 
+/* Writes the events new to this poll, [from, end), replays push one such batch per poll */
 static void
-input__on_key(GLFWwindow* window, int key, int scancode, int action, int mods)
+input__record(input_t* input, uint64_t from)
 {
-    UNUSED(scancode); UNUSED(mods);
+    FILE*   file = input->recording.record;
+    uint8_t buf[32];
+    size_t  len = input__put_varint(buf, input->stream.end - from);
 
-    input_t* input = glfwGetWindowUserPointer(window);
+    fwrite(buf, 1, len, file);
 
-    if (!input)
+    for (uint64_t i = from; i < input->stream.end; ++i) {
+        const input_event_t* event = &input->stream.events[i & (INPUT_EVENT_CAPACITY - 1)];
+        uint64_t dt = event->time > input->recording.record_time ? event->time - input->recording.record_time : 0;
+
+        input->recording.record_time += dt;
+
+        len = 0;
+        buf[len++] = (uint8_t)(event->type | event->action << 4);
+        len += input__put_varint(buf + len, dt);
+
+        if (event->type == INPUT_EVENT_KEY || event->type == INPUT_EVENT_BUTTON) {
+            len += input__put_varint(buf + len, event->code);
+            buf[len++] = event->mods;
+        } else {
+            memcpy(buf + len, &event->x, 4);
+            memcpy(buf + len + 4, &event->y, 4);
+            len += 8;
+        }
+
+        fwrite(buf, 1, len, file);
+    }
+
+    input->recording.frames += 1;
+
+    if (ferror(file)) {
+        loge("Failed to write the input recording, stopped recording");
+        input_record_stop(input);
+    }
+}
+
+/* Pushes the next batch of the recording, stops the replay at its end or at anything that doesn't parse */
+static void
+input__replay(input_t* input)
+{
+    FILE* file = input->recording.replay;
+    int   next = fgetc(file);
+
+    if (next == EOF) {
+        logi("Replayed %llu frames of input", (unsigned long long)input->recording.frames);
+        input_replay_stop(input);
         return;
+    }
 
-    /* Avoid a seg fault if an unknown key is registered */
-    if (key == GLFW_KEY_UNKNOWN)
-        key = KEY_UNKNOWN;
+    ungetc(next, file);
+
+    if (!input__replay_batch(input, file)) {
+        loge("Input recording is corrupt after %llu frames, stopped replaying", (unsigned long long)input->recording.frames);
+        input_replay_stop(input);
+        return;
+    }
+
+    input->recording.frames += 1;
+}
+
+static bool
+input__replay_batch(input_t* input, FILE* file)
+{
+    uint64_t count;
+
+    if (!input__get_varint(file, &count) || count > INPUT_EVENT_CAPACITY)
+        return false;
+
+    for (uint64_t i = 0; i < count; ++i) {
+        input_event_t event = {0};
+        uint64_t dt, code;
+        int      kind = fgetc(file);
+        int      mods;
+
+        if (kind == EOF || !input__get_varint(file, &dt))
+            return false;
+
+        event.type   = kind & 0xf;
+        event.action = (uint8_t)(kind >> 4);
+
+        input->recording.replay_time += dt;
+        event.time = input->recording.replay_time;
+
+        switch (event.type) {
+            case INPUT_EVENT_KEY:
+            case INPUT_EVENT_BUTTON: {
+                if (!input__get_varint(file, &code) || (mods = fgetc(file)) == EOF)
+                    return false;
+
+                if (code >= (event.type == INPUT_EVENT_KEY ? KEY_LAST : MOUSE_BUTTON_LAST))
+                    return false;
+
+                if (event.action != ACTION_PRESS && event.action != ACTION_RELEASE && event.action != ACTION_REPEAT)
+                    return false;
+
+                event.code = (uint16_t)code;
+                event.mods = (uint8_t)mods;
+            } break;
+
+            case INPUT_EVENT_MOVE:
+            case INPUT_EVENT_SCROLL: {
+                if (fread(&event.x, 4, 1, file) != 1 || fread(&event.y, 4, 1, file) != 1)
+                    return false;
+            } break;
+
+            default: {
+                return false;
+            }
+        }
+
+        input__push(input, event);
+    }
+
+    return true;
+}
+
+static size_t
+input__put_varint(uint8_t* buf, uint64_t value)
+{
+    size_t len = 0;
 
-    switch (action) {
-        case ACTION_PRESS: {
-            input->keyboard.keys[key].pressed = !input->keyboard.keys[key].down;
-            input->keyboard.keys[key].down = 1;
+    while (value >= 0x80) {
+        buf[len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+
+    buf[len++] = (uint8_t)value;
+    return len;
+}
+
+static bool
+input__get_varint(FILE* file, uint64_t* value)
+{
+    *value = 0;
+
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        int byte = fgetc(file);
+
+        if (byte == EOF)
+            return false;
+
+        *value |= (uint64_t)(byte & 0x7f) << shift;
+
+        if (!(byte & 0x80))
+            return true;
+    }
+
+    return false;
+}
+
+static void
+input__push(input_t* input, input_event_t event)
+{
+    /* When full the oldest event is overwritten, applied first if it wasn't yet, so the state stays right and only the batch is cut short */
+    if (input->stream.head - input->stream.begin == INPUT_EVENT_CAPACITY) {
+        if (input->stream.begin == input->stream.end) {
+            input__apply(input, &input->stream.events[input->stream.begin & (INPUT_EVENT_CAPACITY - 1)]);
+            input->stream.end += 1;
+        }
+
+        input->stream.begin += 1;
+        input->stream.overflowed += 1;
+
+        log_rate(logw, 1.0, 1, "More than %d input events in a frame, the oldest are left out of the batch", INPUT_EVENT_CAPACITY);
+    }
+
+    input->stream.events[input->stream.head++ & (INPUT_EVENT_CAPACITY - 1)] = event;
+}
+
+static void
+input__apply(input_t* input, const input_event_t* event)
+{
+    switch (event->type) {
+        case INPUT_EVENT_KEY: {
+            size_t   word = event->code >> 6;
+            uint64_t bit  = 1ULL << (event->code & 63);
+
+            if (event->action != ACTION_PRESS && event->action != ACTION_RELEASE)
+                break;
+
+            uint64_t seen = (input->keyboard.pressed[word] | input->keyboard.released[word]) & bit;
+
+            if (event->action == ACTION_PRESS) {
+                input->keyboard.pressed[word] |= bit & ~input->keyboard.down[word];
+                input->keyboard.down[word]    |= bit;
+            } else {
+                input->keyboard.released[word] |= bit;
+                input->keyboard.down[word]     &= ~bit;
+            }
+
+            /* Listed when its first edge of the frame sets a bit, a press of a held key sets none */
+            if (!seen && ((input->keyboard.pressed[word] | input->keyboard.released[word]) & bit))
+                input->keyboard.changed[input->keyboard.changed_count++] = event->code;
+        } break;
+
+        case INPUT_EVENT_BUTTON: {
+            uint8_t bit = (uint8_t)(1U << event->code);
+
+            if (event->action == ACTION_PRESS) {
+                input->mouse.pressed |= bit & ~input->mouse.down;
+                input->mouse.down    |= bit;
+            } else if (event->action == ACTION_RELEASE) {
+                input->mouse.released |= bit;
+                input->mouse.down     &= ~bit;
+            }
+        } break;
+
+        case INPUT_EVENT_MOVE: {
+            input->mouse.xpos = event->x;
+            input->mouse.ypos = event->y;
         } break;
 
-        case ACTION_RELEASE: {
-            input->keyboard.keys[key].released = 1;
-            input->keyboard.keys[key].down = 0;
+        case INPUT_EVENT_SCROLL: {
+            input->mouse.xscroll += event->x;
+            input->mouse.yscroll += event->y;
         } break;
 
         default: {
@@ -218,30 +856,45 @@ input__on_key(GLFWwindow* window, int key, int scancode, int action, int mods)
     }
 }
 
+/* GLFW counts from GLFW_RELEASE = 0, ACTION_* from 1 so that 0 is no action */
+static uint8_t
+input__action(int action)
+{
+    switch (action)
+    {
+        case GLFW_PRESS:   return ACTION_PRESS;
+        case GLFW_RELEASE: return ACTION_RELEASE;
+        case GLFW_REPEAT:  return ACTION_REPEAT;
+        default:           return 0;
+    }
+}
+
 static void
-input__on_button(GLFWwindow* window, int button, int action, int mods)
+input__on_key(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
-    UNUSED(mods);
+    UNUSED(scancode);
 
     input_t* input = glfwGetWindowUserPointer(window);
 
-    if (!input)
+    if (!input || input->recording.replay)
         return;
 
-    switch (action) {
-        case ACTION_PRESS: {
-            input->mouse.buttons[button].pressed = !input->mouse.buttons[button].down;
-            input->mouse.buttons[button].down = 1;
-        } break;
+    /* Avoid a seg fault if an unknown key is registered */
+    if (key < 0 || key >= KEY_LAST)
+        key = KEY_UNKNOWN;
 
-        case ACTION_RELEASE: {
-            input->mouse.buttons[button].released = 1;
-            input->mouse.buttons[button].down = 0;
-        } break;
+    input__push(input, (input_event_t){time_now(), INPUT_EVENT_KEY, (uint16_t)key, input__action(action), (uint8_t)mods, 0.0f, 0.0f});
+}
 
-        default: {
-        } break;
-    }
+static void
+input__on_button(GLFWwindow* window, int button, int action, int mods)
+{
+    input_t* input = glfwGetWindowUserPointer(window);
+
+    if (!input || input->recording.replay || button < 0 || button >= MOUSE_BUTTON_LAST)
+        return;
+
+    input__push(input, (input_event_t){time_now(), INPUT_EVENT_BUTTON, (uint16_t)button, input__action(action), (uint8_t)mods, 0.0f, 0.0f});
 }
 
 static void
@@ -249,11 +902,10 @@ input__on_mouse_move(GLFWwindow* window, double x, double y)
 {
     input_t* input = glfwGetWindowUserPointer(window);
 
-    if (!input)
+    if (!input || input->recording.replay)
         return;
 
-    input->mouse.xpos = x;
-    input->mouse.ypos = y;
+    input__push(input, (input_event_t){time_now(), INPUT_EVENT_MOVE, 0, 0, 0, (float)x, (float)y});
 }
 
 static void
@@ -261,9 +913,8 @@ input__on_mouse_scroll(GLFWwindow* window, double x, double y)
 {
     input_t* input = glfwGetWindowUserPointer(window);
 
-    if (!input)
+    if (!input || input->recording.replay)
         return;
 
-    input->mouse.xscroll = x;
-    input->mouse.yscroll = y;
+    input__push(input, (input_event_t){time_now(), INPUT_EVENT_SCROLL, 0, 0, 0, (float)x, (float)y});
 }
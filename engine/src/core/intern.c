@@ -0,0 +1,359 @@
+#include "engine/core/intern.h"
+#include "engine/core/cstring.h"
+#include "engine/core/thread.h"
+#include "engine/core/memory.h"
+#include "engine/core/log.h"
+
+#include <string.h>
+
+#define INTERN__ARENA_BLOCK (64 * 1024)
+#define INTERN__PAGE_SHIFT  12
+#define INTERN__PAGE_SIZE   (1U << INTERN__PAGE_SHIFT)
+#define INTERN__MAX_PAGES   4096
+
+typedef struct intern__entry_t
+{
+    const char* str;
+    uint32_t    len;
+    uint32_t    hash;
+} intern__entry_t;
+
+/* Index slots keep the hash next to the id so most mismatches never touch the string */
+typedef struct intern__slot_t
+{
+    uint32_t hash;
+    strid_t  id;    /* INTERN_EMPTY marks an unused slot */
+} intern__slot_t;
+
+typedef struct intern__block_t
+{
+    struct intern__block_t* next;
+    size_t used;
+    size_t size;
+} intern__block_t;
+
+static struct
+{
+    mutex_t          lock;
+
+    /* Ids index into fixed size pages, so readers never see the table move */
+    intern__entry_t* pages[INTERN__MAX_PAGES];
+    uint32_t         count;
+
+    intern__slot_t*  slots;
+    size_t           capacity;
+
+    intern__block_t* blocks;
+
+    size_t           string_bytes;
+    size_t           arena_bytes;
+    size_t           probes;
+    size_t           lookups;
+} gPool = {MUTEX_INIT, {0}, 0, NULL, 0, NULL, 0, 0, 0, 0};
+
+static uint32_t         intern__hash(const char* str, size_t len);
+static size_t           intern__find(uint32_t hash, const char* str, size_t len);
+static bool             intern__grow_index(void);
+static const char*      intern__store(const char* str, size_t len);
+static intern__entry_t* intern__entry(strid_t id);
+
+strid_t
+intern_string(const char* str)
+{
+    return intern_string_n(str, strlen(str));
+}
+
+strid_t
+intern_string_n(const char* str, size_t len)
+{
+    if (!len)
+        return INTERN_EMPTY;
+
+    uint32_t hash = intern__hash(str, len);
+    strid_t id = INTERN_NONE;
+
+    mutex_lock(&gPool.lock);
+
+    if (gPool.capacity) {
+        size_t i = intern__find(hash, str, len);
+
+        if (gPool.slots[i].id != INTERN_EMPTY) {
+            id = gPool.slots[i].id;
+            goto unlock;
+        }
+    }
+
+    /* Keep the load factor under one half */
+    if ((gPool.count + 1) * 2 > gPool.capacity && !intern__grow_index())
+        goto unlock;
+
+    /* Id 0 is the implicit empty string, the first real string gets id 1 */
+    strid_t new_id = gPool.count + 1;
+    uint32_t page = new_id >> INTERN__PAGE_SHIFT;
+
+    if (page >= INTERN__MAX_PAGES) {
+        loge("String pool is full (%u strings)", gPool.count);
+        goto unlock;
+    }
+
+    if (!gPool.pages[page]) {
+        intern__entry_t* entries = calloc(INTERN__PAGE_SIZE, sizeof(*entries));
+
+        if (!entries) {
+            loge("Failed to grow the string pool");
+            goto unlock;
+        }
+
+        atomic_set(&gPool.pages[page], entries);
+    }
+
+    const char* stored = intern__store(str, len);
+
+    if (!stored)
+        goto unlock;
+
+    gPool.pages[page][new_id & (INTERN__PAGE_SIZE - 1)] = (intern__entry_t){stored, (uint32_t)len, hash};
+    gPool.slots[intern__find(hash, str, len)] = (intern__slot_t){hash, new_id};
+    gPool.count += 1;
+    gPool.string_bytes += len + 1;
+
+    id = new_id;
+
+unlock:
+    mutex_unlock(&gPool.lock);
+    return id;
+}
+
+strid_t
+intern_lookup(const char* str)
+{
+    return intern_lookup_n(str, strlen(str));
+}
+
+strid_t
+intern_lookup_n(const char* str, size_t len)
+{
+    if (!len)
+        return INTERN_EMPTY;
+
+    uint32_t hash = intern__hash(str, len);
+    strid_t id = INTERN_NONE;
+
+    mutex_lock(&gPool.lock);
+
+    if (gPool.capacity) {
+        size_t i = intern__find(hash, str, len);
+
+        if (gPool.slots[i].id != INTERN_EMPTY)
+            id = gPool.slots[i].id;
+    }
+
+    mutex_unlock(&gPool.lock);
+    return id;
+}
+
+const char*
+intern_get(strid_t id)
+{
+    if (id == INTERN_EMPTY)
+        return "";
+
+    intern__entry_t* entry = intern__entry(id);
+    return entry ? entry->str : NULL;
+}
+
+size_t
+intern_len(strid_t id)
+{
+    if (id == INTERN_EMPTY)
+        return 0;
+
+    intern__entry_t* entry = intern__entry(id);
+    return entry ? entry->len : 0;
+}
+
+void
+intern_stats(intern_stats_t* stats)
+{
+    mutex_lock(&gPool.lock);
+
+    size_t pages = 0;
+    for (size_t i = 0; i < INTERN__MAX_PAGES && gPool.pages[i]; ++i)
+        pages += 1;
+
+    stats->count        = gPool.count;
+    stats->string_bytes = gPool.string_bytes;
+    stats->arena_bytes  = gPool.arena_bytes;
+    stats->index_bytes  = gPool.capacity * sizeof(*gPool.slots);
+    stats->table_bytes  = pages * INTERN__PAGE_SIZE * sizeof(intern__entry_t);
+    stats->probes       = gPool.probes;
+    stats->lookups      = gPool.lookups;
+
+    mutex_unlock(&gPool.lock);
+}
+
+void
+intern_report(void)
+{
+    intern_stats_t stats;
+    intern_stats(&stats);
+
+    size_t total = stats.arena_bytes + stats.index_bytes + stats.table_bytes;
+
+    logi("String pool: %zu strings, %zu B of text in %zu B of arena", stats.count, stats.string_bytes, stats.arena_bytes);
+    logi("String pool: %zu B index, %zu B table, %zu B total (%.3f MB)",
+         stats.index_bytes, stats.table_bytes, total, (double)total / 1000000.0);
+    logi("String pool: %.2f probes per lookup",
+         stats.lookups ? (double)stats.probes / (double)stats.lookups : 0.0);
+}
+
+void
+intern_shutdown(void)
+{
+    mutex_lock(&gPool.lock);
+
+    for (size_t i = 0; i < INTERN__MAX_PAGES; ++i) {
+        free(gPool.pages[i]);
+        gPool.pages[i] = NULL;
+    }
+
+    while (gPool.blocks) {
+        intern__block_t* next = gPool.blocks->next;
+        free(gPool.blocks);
+        gPool.blocks = next;
+    }
+
+    free(gPool.slots);
+
+    gPool.slots        = NULL;
+    gPool.capacity     = 0;
+    gPool.count        = 0;
+    gPool.string_bytes = 0;
+    gPool.arena_bytes  = 0;
+    gPool.probes       = 0;
+    gPool.lookups      = 0;
+
+    mutex_unlock(&gPool.lock);
+}
+
+
+static uint32_t
+intern__hash(const char* str, size_t len)
+{
+    return str_hash32(str, len, 0);
+}
+
+/* Returns the slot holding str, or the empty slot where it would go. Must hold the lock */
+static size_t
+intern__find(uint32_t hash, const char* str, size_t len)
+{
+    size_t mask = gPool.capacity - 1;
+    size_t i = hash & mask;
+
+    gPool.lookups += 1;
+
+    for (;;) {
+        const intern__slot_t* slot = &gPool.slots[i];
+
+        gPool.probes += 1;
+
+        if (slot->id == INTERN_EMPTY)
+            return i;
+
+        if (slot->hash == hash) {
+            const intern__entry_t* entry = intern__entry(slot->id);
+
+            if (entry->len == len && memcmp(entry->str, str, len) == 0)
+                return i;
+        }
+
+        i = (i + 1) & mask;
+    }
+}
+
+static bool
+intern__grow_index(void)
+{
+    size_t capacity = gPool.capacity ? gPool.capacity * 2 : 256;
+    intern__slot_t* slots = calloc(capacity, sizeof(*slots));
+
+    if (!slots) {
+        loge("Failed to grow the string pool index");
+        return false;
+    }
+
+    for (size_t i = 0; i < gPool.capacity; ++i) {
+        intern__slot_t slot = gPool.slots[i];
+
+        if (slot.id == INTERN_EMPTY)
+            continue;
+
+        size_t j = slot.hash & (capacity - 1);
+
+        while (slots[j].id != INTERN_EMPTY)
+            j = (j + 1) & (capacity - 1);
+
+        slots[j] = slot;
+    }
+
+    free(gPool.slots);
+    gPool.slots = slots;
+    gPool.capacity = capacity;
+    return true;
+}
+
+/* Copies str into the arena with a null terminator. Must hold the lock */
+static const char*
+intern__store(const char* str, size_t len)
+{
+    intern__block_t* block = gPool.blocks;
+
+    if (!block || block->size - block->used < len + 1) {
+        size_t size = len + 1 > INTERN__ARENA_BLOCK ? len + 1 : INTERN__ARENA_BLOCK;
+
+        block = malloc(sizeof(*block) + size);
+
+        if (!block) {
+            loge("Failed to allocate %zu B for the string pool", size);
+            return NULL;
+        }
+
+        block->used = 0;
+        block->size = size;
+
+        /* Strings bigger than a block get their own block behind the current one */
+        if (size > INTERN__ARENA_BLOCK && gPool.blocks) {
+            block->next = gPool.blocks->next;
+            gPool.blocks->next = block;
+        } else {
+            block->next = gPool.blocks;
+            gPool.blocks = block;
+        }
+
+        gPool.arena_bytes += size;
+    }
+
+    char* dst = (char*)(block + 1) + block->used;
+    memcpy(dst, str, len);
+    dst[len] = '\0';
+    block->used += len + 1;
+
+    return dst;
+}
+
+static intern__entry_t*
+intern__entry(strid_t id)
+{
+    uint32_t page = id >> INTERN__PAGE_SHIFT;
+
+    if (page >= INTERN__MAX_PAGES)
+        return NULL;
+
+    intern__entry_t* entries = atomic_get(&gPool.pages[page]);
+
+    if (!entries)
+        return NULL;
+
+    intern__entry_t* entry = &entries[id & (INTERN__PAGE_SIZE - 1)];
+    return entry->str ? entry : NULL;
+}
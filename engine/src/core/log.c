@@ -1,12 +1,128 @@
 #include "engine/core/log.h"
+#include "engine/core/thread.h"
 #include "engine/core/timer.h"
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdlib.h> /* The logger uses the untracked allocator, memory.c logs */
+
+#define LOG__MSG_SIZE   224
+#define LOG__RING_SIZE  1024            /* Records per thread, must be a power of two */
+#define LOG__BATCH_SIZE (64 * 1024)
+#define LOG__IDLE_NS    1000000ULL      /* How long the writer sleeps when there is nothing to write */
+
+#define LOG__SITE_READY  2
+#define LOG__HEADER_SIZE 7              /* Type, id and length in front of every message record */
+
+#define LOG__MAX_MODULES 32
+#define LOG__MODULE_SIZE 32
+#define LOG__MAX_SINKS   16
+
+#define LOG__DEDUP_NS    TIME_NS_PER_SEC   /* How often log_dedup reports a run of repeats */
+
+typedef struct log__record_t
+{
+    const log_site_t* site;
+    uint64_t          time;
+    uint32_t          thread;
+    uint32_t          len;
+    bool              binary;           /* msg holds an encoded binary record rather than text */
+    uint32_t          generation;       /* Of the binary log it was encoded for */
+    char              msg[LOG__MSG_SIZE];
+} log__record_t;
+
+/* Single producer (the owning thread), single consumer (the writer thread) */
+typedef struct log__ring_t
+{
+    struct log__ring_t* next;
+    uint32_t            dropped_seen;   /* Only touched by the writer */
+    uint32_t            drained;        /* Same, becomes the tail once the binary batch is written */
+
+    char                pad0[64];
+    uint32_t            head;           /* Written by the owning thread */
+    uint32_t            dropped;
+    char                pad1[64];
+    uint32_t            tail;           /* Written by the writer */
+    char                pad2[64];
+
+    log__record_t       records[LOG__RING_SIZE];
+} log__ring_t;
 
 static unsigned char level_mask = LOG_LEVEL_MAX;
 
-static const char* log_level_name__(int level)
+/* Every filter change bumps it, sites cache their enabled bit against it. Kept to 31 bits */
+uint32_t log__generation = 1;
+
+static struct
+{
+    mutex_t lock;
+    size_t  count;
+
+    struct
+    {
+        char          name[LOG__MODULE_SIZE];
+        unsigned char mask;
+    } modules[LOG__MAX_MODULES];
+} gFilter = {MUTEX_INIT, 0, {{{0}, 0}}};
+
+static void log__console_write(log_sink_t* sink, const log_message_t* message);
+static void log__console_flush(log_sink_t* sink);
+
+static struct
+{
+    log_sink_t sink;
+    size_t     used;
+    char       buf[LOG__BATCH_SIZE];
+} gConsole = {{log__console_write, log__console_flush, NULL, LOG_LEVEL_MAX}, 0, {0}};
+
+/* Sinks are only ever called with the lock held, one message at a time */
+static struct
+{
+    mutex_t     lock;
+    size_t      count;
+    log_sink_t* sinks[LOG__MAX_SINKS];
+} gSinks = {MUTEX_INIT, 1, {&gConsole.sink}};
+
+static struct
+{
+    log__ring_t* rings;     /* Lock-free list, rings are never removed */
+    thread_t     thread;
+    bool         running;
+    bool         registered;
+} gAsync = {NULL, 0, false, false};
+
+static struct
+{
+    mutex_t  lock;          /* Held for every write to file */
+    FILE*    file;
+    bool     active;
+    uint32_t generation;    /* Bumped by every log_binary_start, sites are described once per generation */
+    uint32_t next_site;
+} gBinary = {MUTEX_INIT, NULL, false, 0, 0};
+
+static THREAD_LOCAL log__ring_t* this_ring = NULL;
+
+/* Lock-free list of the log_dedup sites that collapsed something, they're never removed */
+static log__dedup_t* gDedups = NULL;
+
+static void         log__filter_changed(void);
+static void         log__crash_write(int fd, const char* str, size_t len);
+static void         log__limit_lock(log_limit_t* limit);
+static void         log__limit_unlock(log_limit_t* limit);
+static void         log__dedup_report(void);
+static log__ring_t* log__thread_ring(void);
+static void*        log__writer(void* arg);
+static size_t       log__drain(char* binary, size_t* binary_used, uint32_t generation);
+static void         log__dispatch(const log__record_t* record);
+static void         log__flush_sinks(void);
+static void         log__site_init(log_site_t* site, const char* fmt);
+static void         log__site_define(log_site_t* site);
+static uint32_t     log__encode(const log_site_t* site, char* buf, va_list ap);
+static uint32_t     log__text(char* buf, size_t size, const char* fmt, va_list ap);
+static void         log__write_binary(const char* buf, size_t len, uint32_t generation);
+
+const char*
+log_level_name(int level)
 {
     switch (level)
     {
@@ -22,7 +138,8 @@ static const char* log_level_name__(int level)
     return "";
 }
 
-static const char* log_level_color__(int level)
+static const char*
+log_level_color__(int level)
 {
     switch (level)
     {
@@ -42,38 +159,925 @@ static const char* log_level_color__(int level)
 void
 log_enable(unsigned char mask)
 {
+    mutex_lock(&gFilter.lock);
     level_mask |= mask;
+    log__filter_changed();
+    mutex_unlock(&gFilter.lock);
 }
 
 void
 log_disable(unsigned char mask)
 {
+    mutex_lock(&gFilter.lock);
     level_mask &= ~mask;
+    log__filter_changed();
+    mutex_unlock(&gFilter.lock);
 }
 
 void
-log__log(int level,
-         const char* file,
-         int line,
-         const char* func,
-         const char* fmt,
-         ...)
-{
-    if (!(level_mask & level))
+log_module_set(const char* module, unsigned char mask)
+{
+    mutex_lock(&gFilter.lock);
+
+    size_t i = 0;
+
+    while (i < gFilter.count && strcmp(gFilter.modules[i].name, module) != 0)
+        i += 1;
+
+    if (i == LOG__MAX_MODULES || strlen(module) >= LOG__MODULE_SIZE) {
+        mutex_unlock(&gFilter.lock);
+        loge("Can't filter module '%s', at most %d modules of %d characters", module, LOG__MAX_MODULES, LOG__MODULE_SIZE - 1);
         return;
+    }
+
+    if (i == gFilter.count) {
+        strcpy(gFilter.modules[i].name, module);
+        gFilter.count += 1;
+    }
+
+    gFilter.modules[i].mask = mask;
+    log__filter_changed();
+
+    mutex_unlock(&gFilter.lock);
+}
+
+void
+log_module_reset(void)
+{
+    mutex_lock(&gFilter.lock);
+    gFilter.count = 0;
+    log__filter_changed();
+    mutex_unlock(&gFilter.lock);
+}
+
+bool
+log_sink_add(log_sink_t* sink)
+{
+    mutex_lock(&gSinks.lock);
+
+    if (gSinks.count == LOG__MAX_SINKS) {
+        mutex_unlock(&gSinks.lock);
+        loge("Can't add more than %d log sinks", LOG__MAX_SINKS);
+        return false;
+    }
+
+    gSinks.sinks[gSinks.count++] = sink;
+    mutex_unlock(&gSinks.lock);
+    return true;
+}
+
+void
+log_sink_remove(log_sink_t* sink)
+{
+    mutex_lock(&gSinks.lock);
+
+    for (size_t i = 0; i < gSinks.count; ++i) {
+        if (gSinks.sinks[i] == sink) {
+            sink->flush(sink);
+            memmove(&gSinks.sinks[i], &gSinks.sinks[i + 1], (gSinks.count - i - 1) * sizeof(*gSinks.sinks));
+            gSinks.count -= 1;
+            break;
+        }
+    }
+
+    mutex_unlock(&gSinks.lock);
+}
+
+log_sink_t*
+log_console(void)
+{
+    return &gConsole.sink;
+}
+
+void
+log_async_start(void)
+{
+    if (atomic_get(&gAsync.running))
+        return;
+
+    atomic_set(&gAsync.running, true);
+
+    if (!thread_create(&gAsync.thread, log__writer, NULL)) {
+        atomic_set(&gAsync.running, false);
+        return;
+    }
+
+    if (!gAsync.registered) {
+        gAsync.registered = true;
+        atexit(log_async_stop);
+    }
+}
+
+void
+log_async_stop(void)
+{
+    if (!atomic_get(&gAsync.running))
+        return;
+
+    /* Queued ahead of the drain, the writer doesn't outlive this */
+    log__dedup_report();
+
+    /* The writer drains everything before it exits */
+    atomic_set(&gAsync.running, false);
+    thread_join(gAsync.thread);
+}
+
+void
+log_flush(void)
+{
+    if (!atomic_get(&gAsync.running))
+        return;
+
+    for (log__ring_t* ring = atomic_get(&gAsync.rings); ring; ring = ring->next) {
+        uint32_t head = atomic_get(&ring->head);
+
+        while ((int32_t)(atomic_get(&ring->tail) - head) < 0 && atomic_get(&gAsync.running))
+            thread_yield();
+    }
+}
+
+unsigned
+log_dropped(void)
+{
+    unsigned dropped = 0;
+
+    for (log__ring_t* ring = atomic_get(&gAsync.rings); ring; ring = ring->next)
+        dropped += atomic_get_relaxed(&ring->dropped);
+
+    return dropped;
+}
+
+void
+log_crash_dump(int fd)
+{
+#if PLATFORM_POSIX
+    log__crash_write(fd, gConsole.buf, gConsole.used < sizeof(gConsole.buf) ? gConsole.used : 0);
+
+    for (log__ring_t* ring = atomic_get(&gAsync.rings); ring; ring = ring->next) {
+        uint32_t head = atomic_get(&ring->head);
+
+        for (uint32_t tail = atomic_get(&ring->tail); tail != head; ++tail) {
+            const log__record_t* record = &ring->records[tail & (LOG__RING_SIZE - 1)];
+
+            if (record->binary)
+                continue;
+
+            /* snprintf isn't async-signal-safe, so the line number is formatted by hand */
+            char line[16];
+            size_t i = sizeof(line);
+            unsigned value = (unsigned)record->site->line;
+
+            line[--i] = ']';
+            do {
+                line[--i] = (char)('0' + value % 10);
+                value /= 10;
+            } while (value && i > 1);
+            line[--i] = ':';
+
+            const char* level = log_level_name(record->site->level);
+            const char* file = strrchr(record->site->file, '/');
+
+            log__crash_write(fd, "[", 1);
+            log__crash_write(fd, file, strlen(file));
+            log__crash_write(fd, line + i, sizeof(line) - i);
+            log__crash_write(fd, " [", 2);
+            log__crash_write(fd, level, strlen(level));
+            log__crash_write(fd, "] ", 2);
+            log__crash_write(fd, record->site->func, strlen(record->site->func));
+            log__crash_write(fd, "(): ", 4);
+            log__crash_write(fd, record->msg, record->len < LOG__MSG_SIZE ? record->len : LOG__MSG_SIZE);
+            log__crash_write(fd, "\n", 1);
+        }
+    }
+#else
+    UNUSED(fd);
+#endif
+}
+
+bool
+log_binary_start(const char* path)
+{
+    log_binary_stop();
+
+    FILE* file = fopen(path, "wb");
+
+    if (!file) {
+        loge("Failed to open binary log '%s'", path);
+        return false;
+    }
+
+    fwrite(LOG_BINARY_MAGIC, 1, sizeof(LOG_BINARY_MAGIC) - 1, file);
+
+    mutex_lock(&gBinary.lock);
+    gBinary.file = file;
+    atomic_add(&gBinary.generation, 1);
+    atomic_set(&gBinary.active, true);
+    mutex_unlock(&gBinary.lock);
+
+    return true;
+}
+
+void
+log_binary_stop(void)
+{
+    if (!atomic_get(&gBinary.active))
+        return;
+
+    atomic_set(&gBinary.active, false);
+    log_flush();
+
+    mutex_lock(&gBinary.lock);
+    fclose(gBinary.file);
+    gBinary.file = NULL;
+    mutex_unlock(&gBinary.lock);
+}
+
+bool
+log__refresh(log_site_t* site)
+{
+    mutex_lock(&gFilter.lock);
+
+    const char* module = site->module ? site->module : strrchr(site->file, '/') + 1;
+    unsigned char mask = level_mask;
+
+    for (size_t i = 0; i < gFilter.count; ++i) {
+        if (strcmp(gFilter.modules[i].name, module) == 0) {
+            mask = gFilter.modules[i].mask;
+            break;
+        }
+    }
+
+    bool enabled = (mask & site->level) != 0;
+    atomic_set_relaxed(&site->filter, log__generation << 1 | enabled);
+
+    mutex_unlock(&gFilter.lock);
+    return enabled;
+}
+
+bool
+log__once(uint32_t* once)
+{
+    if (atomic_get_relaxed(once))
+        return false;
+
+    uint32_t expected = 0;
+    return atomic_cas(once, &expected, 1);
+}
+
+bool
+log__every_n(log_limit_t* limit, uint32_t n, uint32_t* skipped)
+{
+    uint32_t calls = atomic_add(&limit->calls, 1);
+
+    if (n > 1 && calls % n != 0)
+        return false;
+
+    *skipped = calls && n > 1 ? n - 1 : 0;
+    return true;
+}
+
+bool
+log__rate(log_limit_t* limit, double per_sec, uint32_t burst, uint32_t* skipped)
+{
+    uint64_t now = time_now();
+
+    log__limit_lock(limit);
+
+    if (!limit->stamp)
+        limit->tokens = burst;
+    else
+        limit->tokens += time_to_sec(now - limit->stamp) * per_sec;
+
+    if (limit->tokens > burst)
+        limit->tokens = burst;
+
+    limit->stamp = now;
+
+    bool emit = limit->tokens >= 1.0;
+
+    if (emit) {
+        limit->tokens -= 1.0;
+        *skipped = limit->suppressed;
+        limit->suppressed = 0;
+    } else {
+        limit->suppressed += 1;
+    }
+
+    log__limit_unlock(limit);
+    return emit;
+}
+
+bool
+log__dedup(log__dedup_t* dedup, uint32_t* repeated, const char* fmt, ...)
+{
+    log_limit_t* limit = &dedup->limit;
+
+    char msg[LOG__MSG_SIZE];
 
     va_list ap;
+    va_start(ap, fmt);
+    uint32_t len = log__text(msg, sizeof(msg), fmt, ap);
+    va_end(ap);
+
+    /* FNV-1a, a collision only costs a wrongly collapsed line */
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (uint32_t i = 0; i < len; ++i)
+        hash = (hash ^ (unsigned char)msg[i]) * 1099511628211ULL;
+
+    uint64_t now = time_now();
+    bool emit = true;
+
+    log__limit_lock(limit);
+
+    if (limit->stamp && hash == limit->hash) {
+        limit->suppressed += 1;
+        emit = false;
+
+        /* Listed once, the first time it holds back a count that might otherwise never be reported */
+        uint32_t listed = 0;
+
+        if (atomic_cas(&dedup->listed, &listed, 1)) {
+            log__dedup_t* head = atomic_get(&gDedups);
+
+            do {
+                dedup->next = head;
+            } while (!atomic_cas(&gDedups, &head, dedup));
+
+            static uint32_t registered = 0;
+            uint32_t expected = 0;
+
+            if (atomic_cas(&registered, &expected, 1))
+                atexit(log__dedup_report);
+        }
 
+        /* A long run gets reported periodically rather than only once it ends */
+        if (now - limit->stamp >= LOG__DEDUP_NS) {
+            *repeated = limit->suppressed;
+            limit->suppressed = 0;
+            limit->stamp = now;
+        }
+    } else {
+        *repeated = limit->suppressed;
+        limit->suppressed = 0;
+        limit->stamp = now;
+        limit->hash = hash;
+    }
+
+    log__limit_unlock(limit);
+    return emit;
+}
+
+void
+log__log(log_site_t* site, const char* fmt, ...)
+{
+    if (atomic_get(&site->state) != LOG__SITE_READY)
+        log__site_init(site, fmt);
+
+    bool binary = atomic_get_relaxed(&gBinary.active);
+    uint32_t generation = atomic_get_relaxed(&gBinary.generation);
+
+    if (binary && atomic_get(&site->defined) != generation)
+        log__site_define(site);
+
+    va_list ap;
     va_start(ap, fmt);
-    fprintf(stderr,
-            "[%8s:%3d] [%s%-5s%s] %s(): ",
-            file,
-            line,
-            log_level_color__(level),
-            log_level_name__(level),
-            "\033[0m",
-            func);
-    vfprintf(stderr, fmt, ap);
-    fprintf(stderr, "\n");
+
+    log__ring_t* ring = NULL;
+
+    if (site->level < LOG_LEVEL_FATAL && atomic_get(&gAsync.running) && (ring = log__thread_ring())) {
+        uint32_t head = ring->head;
+
+        if (head - atomic_get(&ring->tail) >= LOG__RING_SIZE) {
+            atomic_add(&ring->dropped, 1);
+            va_end(ap);
+            return;
+        }
+
+        log__record_t* record = &ring->records[head & (LOG__RING_SIZE - 1)];
+
+        record->site       = site;
+        record->time       = time_now();
+        record->thread     = thread_id();
+        record->binary     = binary;
+        record->generation = generation;
+        record->len        = binary ? log__encode(site, record->msg, ap)
+                                    : log__text(record->msg, sizeof(record->msg), fmt, ap);
+
+        /* Publishes the record to the writer */
+        atomic_set(&ring->head, head + 1);
+        va_end(ap);
+        return;
+    }
+
+    /* Fatal messages usually come right before a crash, write everything queued before them first */
+    log_flush();
+
+    log__record_t record;
+    record.site   = site;
+    record.time   = time_now();
+    record.thread = thread_id();
+    record.binary = false;
+
+    if (binary) {
+        va_list copy;
+        va_copy(copy, ap);
+        log__write_binary(record.msg, log__encode(site, record.msg, copy), generation);
+        va_end(copy);
+
+        /* Fatal and assert messages are also shown right away */
+        if (site->level < LOG_LEVEL_FATAL) {
+            va_end(ap);
+            return;
+        }
+    }
+
+    record.len = log__text(record.msg, sizeof(record.msg), fmt, ap);
     va_end(ap);
+
+    mutex_lock(&gSinks.lock);
+    log__dispatch(&record);
+    log__flush_sinks();
+    mutex_unlock(&gSinks.lock);
+}
+
+
+/* Must hold the filter lock */
+static void
+log__filter_changed(void)
+{
+    uint32_t generation = (log__generation + 1) & 0x7fffffff;
+    atomic_set_relaxed(&log__generation, generation ? generation : 1);
+}
+
+static void
+log__crash_write(int fd, const char* str, size_t len)
+{
+#if PLATFORM_POSIX
+    while (len) {
+        ssize_t written = write(fd, str, len);
+
+        if (written <= 0)
+            return;
+
+        str += written;
+        len -= (size_t)written;
+    }
+#else
+    UNUSED(fd);
+    UNUSED(str);
+    UNUSED(len);
+#endif
+}
+
+/* Limiters are static in their macros, so they get a spin lock rather than a mutex needing init */
+static void
+log__limit_lock(log_limit_t* limit)
+{
+    uint32_t expected = 0;
+
+    while (!atomic_cas(&limit->lock, &expected, 1)) {
+        expected = 0;
+        thread_yield();
+    }
+}
+
+static void
+log__limit_unlock(log_limit_t* limit)
+{
+    atomic_set(&limit->lock, 0);
+}
+
+/* Reports the repeats log_dedup is still holding back, at exit and from log_async_stop */
+static void
+log__dedup_report(void)
+{
+    for (log__dedup_t* dedup = atomic_get(&gDedups); dedup; dedup = dedup->next) {
+        log__limit_lock(&dedup->limit);
+        uint32_t repeated = dedup->limit.suppressed;
+        dedup->limit.suppressed = 0;
+        log__limit_unlock(&dedup->limit);
+
+        if (repeated && log__enabled(&dedup->site))
+            log__log(&dedup->site, LOG__REPEATED, repeated);
+    }
+}
+
+static log__ring_t*
+log__thread_ring(void)
+{
+    if (this_ring)
+        return this_ring;
+
+    log__ring_t* ring = calloc(1, sizeof(*ring));
+
+    if (!ring)
+        return NULL;
+
+    ring->next = atomic_get(&gAsync.rings);
+
+    while (!atomic_cas(&gAsync.rings, &ring->next, ring))
+        ;
+
+    this_ring = ring;
+    return ring;
+}
+
+static void*
+log__writer(void* arg)
+{
+    UNUSED(arg);
+
+    static char binary[LOG__BATCH_SIZE];
+    size_t binary_used = 0;
+
+    for (;;) {
+        bool running = atomic_get(&gAsync.running);
+        uint32_t generation = atomic_get(&gBinary.generation);
+
+        mutex_lock(&gSinks.lock);
+        size_t count = log__drain(binary, &binary_used, generation);
+        log__flush_sinks();
+        mutex_unlock(&gSinks.lock);
+
+        log__write_binary(binary, binary_used, generation);
+        binary_used = 0;
+
+        /* Only now, so log_flush doesn't return while the batch is still in memory */
+        for (log__ring_t* ring = atomic_get(&gAsync.rings); ring; ring = ring->next)
+            atomic_set(&ring->tail, ring->drained);
+
+        /* Only exit once a drain after the stop request found nothing left */
+        if (!count && !running)
+            break;
+
+        if (!count)
+            thread_sleep(LOG__IDLE_NS);
+    }
+
+    return NULL;
+}
+
+/*
+ * Hands every queued record to the sinks and moves binary ones of the current
+ * log into the batch, those of a log already stopped are dropped. Must hold the
+ * sink lock. The tails are left for the writer to publish
+ */
+static size_t
+log__drain(char* binary, size_t* binary_used, uint32_t generation)
+{
+    size_t count = 0;
+
+    for (log__ring_t* ring = atomic_get(&gAsync.rings); ring; ring = ring->next) {
+        uint32_t tail = ring->drained;
+        uint32_t head = atomic_get(&ring->head);
+
+        for (; tail != head; ++tail, ++count) {
+            const log__record_t* record = &ring->records[tail & (LOG__RING_SIZE - 1)];
+
+            if (!record->binary) {
+                log__dispatch(record);
+                continue;
+            }
+
+            if (record->generation != generation)
+                continue;
+
+            if (LOG__BATCH_SIZE - *binary_used < LOG__MSG_SIZE) {
+                log__write_binary(binary, *binary_used, generation);
+                *binary_used = 0;
+            }
+
+            memcpy(binary + *binary_used, record->msg, record->len);
+            *binary_used += record->len;
+        }
+
+        ring->drained = tail;
+
+        uint32_t dropped = atomic_get_relaxed(&ring->dropped);
+
+        if (dropped != ring->dropped_seen) {
+            static log_site_t site = {"/" __FILE__, "log__drain", __LINE__, LOG_LEVEL_WARN, NULL, 0, NULL, 0, 0, 0, 0, {0}, {0}};
+            log__record_t notice = {&site, time_now(), thread_id(), 0, false, 0, {0}};
+
+            notice.len = (uint32_t)snprintf(notice.msg, sizeof(notice.msg),
+                                            "%u messages dropped, the ring buffer was full",
+                                            dropped - ring->dropped_seen);
+
+            log__dispatch(&notice);
+            ring->dropped_seen = dropped;
+        }
+    }
+
+    return count;
+}
+
+/* Parses the argument types out of fmt, sites it can't record are formatted up front instead */
+static void
+log__site_init(log_site_t* site, const char* fmt)
+{
+    uint32_t expected = 0;
+
+    if (!atomic_cas(&site->state, &expected, 1)) {
+        while (atomic_get(&site->state) != LOG__SITE_READY)
+            thread_yield();
+        return;
+    }
+
+    site->fmt  = fmt;
+    site->id   = atomic_add(&gBinary.next_site, 1) + 1;
+
+    unsigned nargs = 0;
+
+    for (const char* p = fmt; *p; ++p) {
+        if (*p != '%')
+            continue;
+
+        if (*++p == '%')
+            continue;
+
+        /* Flags, width and precision, a '*' takes an int argument */
+        int precision = LOG__PRECISION_NONE;
+
+        for (; *p && strchr("-+ #0123456789.*", *p); ++p) {
+            if (*p == '.')
+                precision = 0;
+            else if (precision >= 0 && *p >= '0' && *p <= '9')
+                precision = precision > (INT16_MAX - 9) / 10 ? INT16_MAX : precision * 10 + (*p - '0');
+
+            if (*p != '*')
+                continue;
+
+            if (precision == 0)
+                precision = LOG__PRECISION_ARG;
+
+            if (nargs == LOG_SITE_ARGS)
+                goto text;
+
+            site->precision[nargs] = LOG__PRECISION_NONE;
+            site->args[nargs++] = LOG_ARG_INT;
+        }
+
+        int type = LOG_ARG_INT;
+
+        switch (*p) {
+            case 'h': p += p[1] == 'h' ? 2 : 1; break;
+            case 'l': type = p[1] == 'l' ? LOG_ARG_LLONG : LOG_ARG_LONG;
+                      p += p[1] == 'l' ? 2 : 1; break;
+            case 'z': type = LOG_ARG_SIZE;    p += 1; break;
+            case 'j': type = LOG_ARG_INTMAX;  p += 1; break;
+            case 't': type = LOG_ARG_PTRDIFF; p += 1; break;
+            case 'L': type = LOG_ARG_LDOUBLE; p += 1; break;
+        }
+
+        switch (*p) {
+            case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+                if (type == LOG_ARG_LDOUBLE)
+                    goto text;
+                break;
+
+            case 'c':
+                type = LOG_ARG_INT;
+                break;
+
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+                type = type == LOG_ARG_LDOUBLE ? LOG_ARG_LDOUBLE : LOG_ARG_DOUBLE;
+                break;
+
+            case 's':
+                type = LOG_ARG_STRING;
+                break;
+
+            case 'p':
+                type = LOG_ARG_PTR;
+                break;
+
+            default:
+                goto text;
+        }
+
+        if (nargs == LOG_SITE_ARGS)
+            goto text;
+
+        site->precision[nargs] = (int16_t)precision;
+        site->args[nargs++] = (unsigned char)type;
+    }
+
+    site->nargs = (unsigned char)nargs;
+    atomic_set(&site->state, LOG__SITE_READY);
+    return;
+
+text:
+    site->nargs = LOG_ARG_TEXT;
+    atomic_set(&site->state, LOG__SITE_READY);
+}
+
+/* Writes the site's description ahead of its first message in the current binary log */
+static void
+log__site_define(log_site_t* site)
+{
+    mutex_lock(&gBinary.lock);
+
+    if (!gBinary.file || site->defined == gBinary.generation) {
+        mutex_unlock(&gBinary.lock);
+        return;
+    }
+
+    unsigned char type  = LOG_BINARY_SITE;
+    unsigned char level = (unsigned char)site->level;
+    unsigned char nargs = site->nargs == LOG_ARG_TEXT ? 0 : site->nargs;
+    uint32_t line = (uint32_t)site->line;
+
+    fwrite(&type, 1, 1, gBinary.file);
+    fwrite(&site->id, 4, 1, gBinary.file);
+    fwrite(&level, 1, 1, gBinary.file);
+    fwrite(&line, 4, 1, gBinary.file);
+    fwrite(&nargs, 1, 1, gBinary.file);
+    fwrite(site->args, 1, nargs, gBinary.file);
+
+    const char* strings[] = {strrchr(site->file, '/'), site->func, site->fmt};
+
+    for (size_t i = 0; i < 3; ++i) {
+        size_t len = strlen(strings[i]);
+        uint16_t len16 = len > UINT16_MAX ? UINT16_MAX : (uint16_t)len;
+
+        fwrite(&len16, 2, 1, gBinary.file);
+        fwrite(strings[i], 1, len16, gBinary.file);
+    }
+
+    /* Published after the description, so no message can be written ahead of it */
+    atomic_set(&site->defined, gBinary.generation);
+    mutex_unlock(&gBinary.lock);
+}
+
+/* Encodes a MESSAGE (or TEXT) record into buf, which holds LOG__MSG_SIZE bytes */
+static uint32_t
+log__encode(const log_site_t* site, char* buf, va_list ap)
+{
+    uint32_t len = LOG__HEADER_SIZE;
+
+    if (site->nargs == LOG_ARG_TEXT) {
+        buf[0] = LOG_BINARY_TEXT;
+        len += log__text(buf + len, LOG__MSG_SIZE - len, site->fmt, ap);
+    } else {
+        buf[0] = LOG_BINARY_MESSAGE;
+
+        /* Scalars always fit, strings get whatever room is left after them */
+        size_t reserve = 0;
+
+        for (unsigned i = 0; i < site->nargs; ++i)
+            reserve += site->args[i] == LOG_ARG_STRING ? 2 : 8;
+
+        /* The value of the argument before, a '*' precision of a string */
+        int64_t last = 0;
+
+        for (unsigned i = 0; i < site->nargs; ++i) {
+            int64_t value = 0;
+            double real = 0.0;
+
+            switch (site->args[i]) {
+                case LOG_ARG_INT:     value = va_arg(ap, int);                       break;
+                case LOG_ARG_LONG:    value = va_arg(ap, long);                      break;
+                case LOG_ARG_LLONG:   value = va_arg(ap, long long);                 break;
+                case LOG_ARG_SIZE:    value = (int64_t)va_arg(ap, size_t);           break;
+                case LOG_ARG_INTMAX:  value = va_arg(ap, intmax_t);                  break;
+                case LOG_ARG_PTRDIFF: value = va_arg(ap, ptrdiff_t);                 break;
+                case LOG_ARG_PTR:     value = (int64_t)(uintptr_t)va_arg(ap, void*); break;
+                case LOG_ARG_DOUBLE:  real  = va_arg(ap, double);                    break;
+                case LOG_ARG_LDOUBLE: real  = (double)va_arg(ap, long double);       break;
+
+                case LOG_ARG_STRING: {
+                    const char* str = va_arg(ap, const char*);
+                    str = str ? str : "(null)";
+                    reserve -= 2;
+
+                    size_t max = LOG__MSG_SIZE - len - 2 - reserve;
+                    size_t n = 0;
+
+                    /* The string needn't be terminated within its precision, e.g. STRVIEW_ARG. A negative '*' is none */
+                    int64_t precision = site->precision[i] == LOG__PRECISION_ARG ? last : site->precision[i];
+
+                    if (precision >= 0 && (uint64_t)precision < max)
+                        max = (size_t)precision;
+
+                    while (n < max && str[n])
+                        n += 1;
+
+                    uint16_t n16 = (uint16_t)n;
+                    memcpy(buf + len, &n16, 2);
+                    memcpy(buf + len + 2, str, n);
+                    len += 2 + (uint32_t)n;
+                    continue;
+                }
+            }
+
+            if (site->args[i] == LOG_ARG_DOUBLE || site->args[i] == LOG_ARG_LDOUBLE)
+                memcpy(buf + len, &real, 8);
+            else
+                memcpy(buf + len, &value, 8);
+
+            reserve -= 8;
+            len += 8;
+            last = value;
+        }
+    }
+
+    uint16_t payload = (uint16_t)(len - LOG__HEADER_SIZE);
+
+    memcpy(buf + 1, &site->id, 4);
+    memcpy(buf + 5, &payload, 2);
+
+    return len;
+}
+
+static uint32_t
+log__text(char* buf, size_t size, const char* fmt, va_list ap)
+{
+    int len = vsnprintf(buf, size, fmt, ap);
+
+    if (len < 0)
+        return 0;
+
+    return (size_t)len < size ? (uint32_t)len : (uint32_t)size - 1;
+}
+
+/* Must hold the sink lock */
+static void
+log__dispatch(const log__record_t* record)
+{
+    log_message_t message = {
+        strrchr(record->site->file, '/'),
+        record->site->func,
+        record->site->line,
+        record->site->level,
+        record->time,
+        record->thread,
+        record->msg,
+        record->len
+    };
+
+    for (size_t i = 0; i < gSinks.count; ++i)
+        if (gSinks.sinks[i]->mask & message.level)
+            gSinks.sinks[i]->write(gSinks.sinks[i], &message);
+}
+
+/* Must hold the sink lock */
+static void
+log__flush_sinks(void)
+{
+    for (size_t i = 0; i < gSinks.count; ++i)
+        gSinks.sinks[i]->flush(gSinks.sinks[i]);
+}
+
+static void
+log__console_write(log_sink_t* sink, const log_message_t* message)
+{
+    UNUSED(sink);
+
+    if (sizeof(gConsole.buf) - gConsole.used < message->len + 128)
+        log__console_flush(sink);
+
+    int len = snprintf(gConsole.buf + gConsole.used,
+                       sizeof(gConsole.buf) - gConsole.used,
+                       "[%8s:%3d] [%s%-5s%s] %s(): %.*s\n",
+                       message->file,
+                       message->line,
+                       log_level_color__(message->level),
+                       log_level_name(message->level),
+                       "\033[0m",
+                       message->func,
+                       (int)message->len,
+                       message->msg);
+
+    if (len > 0)
+        gConsole.used += (size_t)len < sizeof(gConsole.buf) - gConsole.used ? (size_t)len : sizeof(gConsole.buf) - gConsole.used - 1;
+}
+
+/* One fwrite per batch, so lines from different threads never interleave */
+static void
+log__console_flush(log_sink_t* sink)
+{
+    UNUSED(sink);
+
+    if (!gConsole.used)
+        return;
+
+    fwrite(gConsole.buf, 1, gConsole.used, stderr);
+    fflush(stderr);
+    gConsole.used = 0;
+}
+
+static void
+log__write_binary(const char* buf, size_t len, uint32_t generation)
+{
+    if (!len)
+        return;
+
+    mutex_lock(&gBinary.lock);
+
+    /* A log started since the records were encoded doesn't know their sites */
+    if (gBinary.file && gBinary.generation == generation)
+        fwrite(buf, 1, len, gBinary.file);
+
+    mutex_unlock(&gBinary.lock);
 }
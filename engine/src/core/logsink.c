@@ -0,0 +1,365 @@
+#include "engine/core/logsink.h"
+#include "engine/core/thread.h"
+#include "engine/core/timer.h"
+#include "engine/core/memory.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#define LOGSINK__BUFFER_SIZE (64 * 1024)
+
+typedef struct logsink__file_t
+{
+    log_sink_t sink;
+    FILE*      file;
+    char*      path;
+    char*      buffer;
+    int        format;
+    size_t     size;        /* Bytes in the current file */
+    size_t     max_size;
+    time_t     opened;
+    uint32_t   max_age;
+    unsigned   keep;
+    size_t     buffer_size;
+} logsink__file_t;
+
+typedef struct logsink__line_t
+{
+    int      level;
+    uint32_t len;
+    char     text[LOGSINK_RING_LINE];
+} logsink__line_t;
+
+typedef struct logsink__ring_t
+{
+    log_sink_t       sink;
+    mutex_t          lock;  /* Guards the lines against readers, writes are already serialized by the log */
+    uint64_t         head;  /* Lines written so far */
+    size_t           capacity;
+    logsink__line_t* lines;
+} logsink__ring_t;
+
+static bool logsink__file_open(logsink__file_t* file, const char* mode);
+static void logsink__file_rotate(logsink__file_t* file);
+static void logsink__file_write(log_sink_t* sink, const log_message_t* message);
+static void logsink__file_flush(log_sink_t* sink);
+static void logsink__file_destroy(log_sink_t* sink);
+static int  logsink__json_string(FILE* file, const char* str, size_t len);
+static void logsink__ring_write(log_sink_t* sink, const log_message_t* message);
+static void logsink__ring_flush(log_sink_t* sink);
+static void logsink__ring_destroy(log_sink_t* sink);
+
+log_sink_t*
+logsink_file_create(const logsink_file_props_t* props)
+{
+    logsink__file_t* file = calloc(1, sizeof(*file));
+
+    if (!file)
+        return NULL;
+
+    file->sink        = (log_sink_t){logsink__file_write, logsink__file_flush, logsink__file_destroy, LOG_LEVEL_MAX};
+    file->format      = props->format;
+    file->max_size    = props->max_size;
+    file->max_age     = props->max_age;
+    file->keep        = props->keep;
+    file->buffer_size = props->buffer ? props->buffer : LOGSINK__BUFFER_SIZE;
+    file->path        = malloc(strlen(props->path) + 1);
+    file->buffer      = malloc(file->buffer_size);
+
+    if (!file->path || !file->buffer) {
+        logsink__file_destroy(&file->sink);
+        return NULL;
+    }
+
+    strcpy(file->path, props->path);
+
+    if (!logsink__file_open(file, "a")) {
+        logsink__file_destroy(&file->sink);
+        return NULL;
+    }
+
+    return &file->sink;
+}
+
+log_sink_t*
+logsink_ring_create(size_t lines)
+{
+    logsink__ring_t* ring = calloc(1, sizeof(*ring));
+
+    if (!ring)
+        return NULL;
+
+    ring->sink     = (log_sink_t){logsink__ring_write, logsink__ring_flush, logsink__ring_destroy, LOG_LEVEL_MAX};
+    ring->capacity = lines ? lines : 1;
+    ring->lines    = calloc(ring->capacity, sizeof(*ring->lines));
+
+    if (!ring->lines) {
+        free(ring);
+        return NULL;
+    }
+
+    mutex_init(&ring->lock);
+    return &ring->sink;
+}
+
+size_t
+logsink_ring_count(log_sink_t* sink)
+{
+    logsink__ring_t* ring = (logsink__ring_t*)sink;
+
+    mutex_lock(&ring->lock);
+    size_t count = ring->head < ring->capacity ? (size_t)ring->head : ring->capacity;
+    mutex_unlock(&ring->lock);
+
+    return count;
+}
+
+int
+logsink_ring_line(log_sink_t* sink, size_t i, char* buf, size_t size)
+{
+    logsink__ring_t* ring = (logsink__ring_t*)sink;
+    int level = 0;
+
+    mutex_lock(&ring->lock);
+
+    size_t count = ring->head < ring->capacity ? (size_t)ring->head : ring->capacity;
+
+    if (i < count && size) {
+        const logsink__line_t* line = &ring->lines[(ring->head - count + i) % ring->capacity];
+        size_t len = line->len < size - 1 ? line->len : size - 1;
+
+        memcpy(buf, line->text, len);
+        buf[len] = '\0';
+        level = line->level;
+    }
+
+    mutex_unlock(&ring->lock);
+    return level;
+}
+
+void
+logsink_ring_dump(log_sink_t* sink, int fd)
+{
+#if PLATFORM_POSIX
+    logsink__ring_t* ring = (logsink__ring_t*)sink;
+
+    /* No lock, a line being written while crashing comes out garbled rather than deadlocking */
+    uint64_t head = atomic_get(&ring->head);
+    size_t count = head < ring->capacity ? (size_t)head : ring->capacity;
+
+    for (size_t i = 0; i < count; ++i) {
+        const logsink__line_t* line = &ring->lines[(head - count + i) % ring->capacity];
+        size_t len = line->len < LOGSINK_RING_LINE ? line->len : LOGSINK_RING_LINE;
+
+        if (write(fd, line->text, len) < 0 || write(fd, "\n", 1) < 0)
+            return;
+    }
+#else
+    UNUSED(sink);
+    UNUSED(fd);
+#endif
+}
+
+void
+logsink_destroy(log_sink_t* sink)
+{
+    if (!sink)
+        return;
+
+    log_sink_remove(sink);
+    sink->flush(sink);
+    sink->destroy(sink);
+}
+
+
+static bool
+logsink__file_open(logsink__file_t* file, const char* mode)
+{
+    file->file = fopen(file->path, mode);
+
+    if (!file->file) {
+        loge("Failed to open log file '%s'", file->path);
+        return false;
+    }
+
+    setvbuf(file->file, file->buffer, _IOFBF, file->buffer_size);
+
+    fseek(file->file, 0, SEEK_END);
+    long size = ftell(file->file);
+
+    file->size   = size > 0 ? (size_t)size : 0;
+    file->opened = time(NULL);
+    return true;
+}
+
+/* path.keep-1 -> path.keep, ..., path -> path.1, then starts a fresh path */
+static void
+logsink__file_rotate(logsink__file_t* file)
+{
+    fclose(file->file);
+    file->file = NULL;
+
+    size_t len = strlen(file->path) + 16;
+    char from[len];
+    char to[len];
+
+    for (unsigned i = file->keep; i > 1; --i) {
+        snprintf(from, len, "%s.%u", file->path, i - 1);
+        snprintf(to, len, "%s.%u", file->path, i);
+        rename(from, to);
+    }
+
+    if (file->keep) {
+        snprintf(to, len, "%s.1", file->path);
+        rename(file->path, to);
+    }
+
+    /* Errors can't be logged from inside a sink, a failed reopen just stops this sink */
+    file->file = fopen(file->path, "w");
+
+    if (file->file)
+        setvbuf(file->file, file->buffer, _IOFBF, file->buffer_size);
+
+    file->size   = 0;
+    file->opened = time(NULL);
+}
+
+static void
+logsink__file_write(log_sink_t* sink, const log_message_t* message)
+{
+    logsink__file_t* file = (logsink__file_t*)sink;
+
+    if ((file->max_size && file->size >= file->max_size) ||
+        (file->max_age && time(NULL) - file->opened >= (time_t)file->max_age))
+        logsink__file_rotate(file);
+
+    if (!file->file)
+        return;
+
+    char stamp[16];
+    time_stamp(stamp);
+
+    const char* name = message->file + (message->file[0] == '/');
+    int len;
+
+    if (file->format == LOGSINK_JSON) {
+        len = fprintf(file->file,
+                      "{\"time\":\"%s\",\"level\":\"%s\",\"file\":\"%s\",\"line\":%d,\"func\":\"%s\",\"thread\":%u,\"msg\":",
+                      stamp,
+                      log_level_name(message->level),
+                      name,
+                      message->line,
+                      message->func,
+                      message->thread);
+
+        len += logsink__json_string(file->file, message->msg, message->len);
+        len += fprintf(file->file, "}\n");
+    } else {
+        len = fprintf(file->file,
+                      "%s [%s:%d] [%-5s] %s(): %.*s\n",
+                      stamp,
+                      name,
+                      message->line,
+                      log_level_name(message->level),
+                      message->func,
+                      (int)message->len,
+                      message->msg);
+    }
+
+    if (len > 0)
+        file->size += (size_t)len;
+}
+
+static void
+logsink__file_flush(log_sink_t* sink)
+{
+    logsink__file_t* file = (logsink__file_t*)sink;
+
+    if (file->file)
+        fflush(file->file);
+}
+
+static void
+logsink__file_destroy(log_sink_t* sink)
+{
+    logsink__file_t* file = (logsink__file_t*)sink;
+
+    if (file->file)
+        fclose(file->file);
+
+    free(file->buffer);
+    free(file->path);
+    free(file);
+}
+
+/* Writes str as a quoted JSON string, returns the number of bytes written */
+static int
+logsink__json_string(FILE* file, const char* str, size_t len)
+{
+    int written = 2;
+    putc('"', file);
+
+    for (size_t i = 0; i < len; ++i) {
+        unsigned char c = (unsigned char)str[i];
+
+        switch (c) {
+            case '"':  fputs("\\\"", file); written += 2; break;
+            case '\\': fputs("\\\\", file); written += 2; break;
+            case '\n': fputs("\\n", file);  written += 2; break;
+            case '\r': fputs("\\r", file);  written += 2; break;
+            case '\t': fputs("\\t", file);  written += 2; break;
+
+            default:
+                if (c < 0x20) {
+                    written += fprintf(file, "\\u%04x", c);
+                } else {
+                    putc(c, file);
+                    written += 1;
+                }
+        }
+    }
+
+    putc('"', file);
+    return written;
+}
+
+static void
+logsink__ring_write(log_sink_t* sink, const log_message_t* message)
+{
+    logsink__ring_t* ring = (logsink__ring_t*)sink;
+
+    mutex_lock(&ring->lock);
+
+    logsink__line_t* line = &ring->lines[ring->head % ring->capacity];
+    int len = snprintf(line->text,
+                       sizeof(line->text),
+                       "[%8s:%3d] [%-5s] %s(): %.*s",
+                       message->file,
+                       message->line,
+                       log_level_name(message->level),
+                       message->func,
+                       (int)message->len,
+                       message->msg);
+
+    line->level = message->level;
+    line->len   = len < 0 ? 0 : len >= LOGSINK_RING_LINE ? LOGSINK_RING_LINE - 1 : (uint32_t)len;
+
+    atomic_set(&ring->head, ring->head + 1);
+    mutex_unlock(&ring->lock);
+}
+
+static void
+logsink__ring_flush(log_sink_t* sink)
+{
+    UNUSED(sink);
+}
+
+static void
+logsink__ring_destroy(log_sink_t* sink)
+{
+    logsink__ring_t* ring = (logsink__ring_t*)sink;
+
+    mutex_destroy(&ring->lock);
+    free(ring->lines);
+    free(ring);
+}
@@ -1,6 +1,8 @@
 #define MEMORY_RECURSION_GUARD
 #include "engine/core/memory.h"
 #include "engine/core/log.h"
+#include "engine/core/thread.h"
+#include "engine/core/trace.h"
 
 #include <string.h>
 #include <stdlib.h>
@@ -18,21 +20,12 @@ typedef struct mem__entry_t
 #endif
 } mem__entry_t;
 
-static struct
-{
-    size_t total;
-    size_t current;
-    size_t peak;
-
-    int failed;
-    int mallocs;
-    int callocs;
-    int reallocs;
-    int frees;
-} gStats = {0};
+/* Updated with atomics, threads allocate concurrently (e.g. the app's render thread) */
+static memory_stats_t gStats = {0};
 
 
 static void mem__exit(void);
+static void mem__count(size_t size);
 
 void
 mem_init(void)
@@ -40,6 +33,19 @@ mem_init(void)
     atexit(mem__exit);
 }
 
+void
+memory_stats(memory_stats_t* stats)
+{
+    stats->total    = atomic_get_relaxed(&gStats.total);
+    stats->current  = atomic_get_relaxed(&gStats.current);
+    stats->peak     = atomic_get_relaxed(&gStats.peak);
+    stats->failed   = atomic_get_relaxed(&gStats.failed);
+    stats->mallocs  = atomic_get_relaxed(&gStats.mallocs);
+    stats->callocs  = atomic_get_relaxed(&gStats.callocs);
+    stats->reallocs = atomic_get_relaxed(&gStats.reallocs);
+    stats->frees    = atomic_get_relaxed(&gStats.frees);
+}
+
 static void
 mem__exit(void)
 {
@@ -69,7 +75,7 @@ void*
 mem__alloc(size_t size, const char* file, int line, const char* func)
 {
     if (!size) {
-        logw("Tried to allocate a block of size 0. Adjusting size...");
+        log_dedup(logw, "Tried to allocate a block of size 0. Adjusting size...");
         size = 1;
     }
 
@@ -77,7 +83,7 @@ mem__alloc(size_t size, const char* file, int line, const char* func)
 
     if (!(mem)) {
         loge("Could not allocate %zu B", size);
-        gStats.failed += 1;
+        atomic_add(&gStats.failed, 1);
         return NULL;
     }
 
@@ -85,15 +91,12 @@ mem__alloc(size_t size, const char* file, int line, const char* func)
         size, (uintptr_t)(mem + 1), file, func, line
     };
 
-    memcpy(mem, &tmp, size + sizeof(*mem));
+    memcpy(mem, &tmp, sizeof(*mem));
 
-    gStats.total += size;
-    gStats.current += size;
+    mem__count(size);
+    atomic_add(&gStats.mallocs, 1);
 
-    if (gStats.current > gStats.peak)
-        gStats.peak = gStats.current;
-
-    gStats.mallocs += 1;
+    trace__alloc(size, file, line);
 
     return (void*)(mem + 1);
 }
@@ -102,12 +105,12 @@ void*
 mem__calloc(size_t count, size_t size, const char* file, int line, const char* func)
 {
     if (!size) {
-        logw("Tried to allocate a block of size 0. Adjusting size...");
+        log_dedup(logw, "Tried to allocate a block of size 0. Adjusting size...");
         size = 1;
     }
 
     if (!count) {
-        logw("Tried to allocate a block of size 0. Adjusting size...");
+        log_dedup(logw, "Tried to allocate a block of size 0. Adjusting size...");
         count = 1;
     }
 
@@ -115,7 +118,7 @@ mem__calloc(size_t count, size_t size, const char* file, int line, const char* f
 
     if (!(mem)) {
         loge("Could not allocate %zu B", count * size);
-        gStats.failed += 1;
+        atomic_add(&gStats.failed, 1);
         return NULL;
     }
 
@@ -123,15 +126,12 @@ mem__calloc(size_t count, size_t size, const char* file, int line, const char* f
         count * size, (uintptr_t)(mem + 1), file, func, line
     };
 
-    memcpy(mem, &tmp, size + sizeof(*mem));
-
-    gStats.total += size;
-    gStats.current += size;
+    memcpy(mem, &tmp, sizeof(*mem));
 
-    if (gStats.current > gStats.peak)
-        gStats.peak = gStats.current;
+    mem__count(count * size);
+    atomic_add(&gStats.callocs, 1);
 
-    gStats.callocs += 1;
+    trace__alloc(count * size, file, line);
 
     return (void*)(mem + 1);
 }
@@ -140,16 +140,20 @@ void*
 mem__realloc(void* ptr, size_t size, const char* file, int line, const char* func)
 {
     if (!size) {
-        logw("Tried to allocate a block of size 0. Adjusting size...");
+        log_dedup(logw, "Tried to allocate a block of size 0. Adjusting size...");
         size = 1;
     }
 
+    if (!ptr)
+        return mem__alloc(size, file, line, func);
+
     mem__entry_t* head = (mem__entry_t*)ptr - 1;
+    size_t old_size = head->size;
     mem__entry_t* mem = realloc(head, size + sizeof(*mem));
 
     if (!(mem)) {
         loge("Could not allocate %zu B", size);
-        gStats.failed += 1;
+        atomic_add(&gStats.failed, 1);
         return ptr;
     }
 
@@ -157,15 +161,13 @@ mem__realloc(void* ptr, size_t size, const char* file, int line, const char* fun
         size, (uintptr_t)(mem + 1), file, func, line
     };
 
-    memcpy(mem, &tmp, size + sizeof(*mem));
+    memcpy(mem, &tmp, sizeof(*mem));
 
-    gStats.total += size - head->size;
-    gStats.current += size - head->size;
+    /* Wraps around for a shrink, which subtracts */
+    mem__count(size - old_size);
+    atomic_add(&gStats.reallocs, 1);
 
-    if (gStats.current > gStats.peak)
-        gStats.peak = gStats.current;
-
-    gStats.reallocs += 1;
+    trace__alloc(size, file, line);
 
     return (void*)(mem + 1);
 }
@@ -180,9 +182,22 @@ mem__free(void* ptr, const char* file, int line, const char* func)
 
     mem__entry_t* head = (mem__entry_t*)ptr - 1;
 
-    gStats.current -= head->size;
+    atomic_add(&gStats.current, -head->size);
+    atomic_add(&gStats.frees, 1);
 
     free(head);
     head = NULL;
 }
 
+static void
+mem__count(size_t size)
+{
+    atomic_add(&gStats.total, size);
+
+    size_t current = atomic_add(&gStats.current, size) + size;
+    size_t peak = atomic_get_relaxed(&gStats.peak);
+
+    /* A failed cas reloads peak, it stops once another thread raised it past current */
+    while (current > peak && !atomic_cas(&gStats.peak, &peak, current))
+        ;
+}
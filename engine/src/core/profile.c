@@ -0,0 +1,384 @@
+#include "engine/core/profile.h"
+#include "engine/core/thread.h"
+#include "engine/core/timer.h"
+#include "engine/core/trace.h"
+
+#include <stdlib.h> /* Untracked like the log, thread buffers live until exit */
+
+#define PROFILE__RING_SIZE   16384      /* Events per thread, must be a power of two */
+#define PROFILE__MAX_DEPTH   64
+#define PROFILE__MAX_NODES   1024       /* Distinct zones per thread and frame */
+#define PROFILE__MAX_THREADS 64
+#define PROFILE__NONE        UINT32_MAX
+
+typedef struct profile__event_t
+{
+    const profile_zone_t* zone;         /* NULL ends the innermost open zone */
+    uint64_t              time;
+} profile__event_t;
+
+/* A node of the call tree being built, children are linked in the order they first ran */
+typedef struct profile__node_t
+{
+    const profile_zone_t* zone;
+    uint32_t              parent;
+    uint32_t              first;
+    uint32_t              last;
+    uint32_t              next;
+    uint32_t              calls;
+    uint64_t              inclusive;
+    uint64_t              children;
+} profile__node_t;
+
+/* Single producer (the owning thread), single consumer (profile_frame) */
+typedef struct profile__ring_t
+{
+    struct profile__ring_t* next;
+    uint32_t                thread;
+
+    /* Owning thread only */
+    uint32_t                recorded;   /* Open zones that made it in, their ends have room reserved */
+    uint32_t                skip;       /* Open zones that were dropped, their ends are dropped as well */
+    uint32_t                tail_cache;
+
+    char                    pad0[64];
+    uint32_t                head;       /* Written by the owning thread */
+    uint32_t                dropped;
+    char                    pad1[64];
+    uint32_t                tail;       /* Written by profile_frame */
+    char                    pad2[64];
+
+    /* profile_frame only, zones stay open across frames */
+    uint32_t                depth;
+    uint32_t                ignored;    /* Open zones deeper than PROFILE__MAX_DEPTH or past PROFILE__MAX_NODES */
+    const profile_zone_t*   open[PROFILE__MAX_DEPTH];
+    uint64_t                open_start[PROFILE__MAX_DEPTH];     /* Clipped to the frame */
+    uint64_t                open_begin[PROFILE__MAX_DEPTH];     /* Where the zone really began, for the trace */
+    uint32_t                open_node[PROFILE__MAX_DEPTH];
+    uint32_t                count;
+    profile__node_t         nodes[PROFILE__MAX_NODES];
+
+    profile__event_t        events[PROFILE__RING_SIZE];
+} profile__ring_t;
+
+static struct
+{
+    profile__ring_t* rings;     /* Lock-free list, rings are never removed */
+    mutex_t          lock;      /* Serializes profile_frame */
+    uint64_t         boundary;
+    size_t           capacity;
+    profile_frame_t  frame;
+} gProfile = {NULL, MUTEX_INIT, 0, 0, {0, 0, 0, 0, NULL}};
+
+static THREAD_LOCAL profile__ring_t* this_ring = NULL;
+
+static profile__ring_t* profile__thread_ring(void);
+static void             profile__aggregate(profile__ring_t* ring, uint64_t now);
+static uint32_t         profile__child(profile__ring_t* ring, uint32_t parent, const profile_zone_t* zone);
+static bool             profile__emit(const profile__ring_t* ring, uint32_t node, uint32_t depth);
+
+void
+profile_frame(void)
+{
+    mutex_lock(&gProfile.lock);
+
+    uint64_t now = time_now();
+
+    gProfile.frame.index   += 1;
+    gProfile.frame.start    = gProfile.boundary ? gProfile.boundary : now;
+    gProfile.frame.duration = now - gProfile.frame.start;
+    gProfile.frame.count    = 0;
+    gProfile.boundary       = now;
+
+    /* The list is newest first, the frame lists threads in the order they started */
+    profile__ring_t* rings[PROFILE__MAX_THREADS];
+    size_t count = 0;
+
+    for (profile__ring_t* ring = atomic_get(&gProfile.rings); ring && count < PROFILE__MAX_THREADS; ring = ring->next)
+        rings[count++] = ring;
+
+    while (count--) {
+        profile__ring_t* ring = rings[count];
+        profile__aggregate(ring, now);
+
+        for (uint32_t i = 0; i < ring->count; ++i)
+            if (ring->nodes[i].parent == PROFILE__NONE && !profile__emit(ring, i, 0))
+                break;
+    }
+
+    mutex_unlock(&gProfile.lock);
+}
+
+const profile_frame_t*
+profile_last(void)
+{
+    return &gProfile.frame;
+}
+
+profile_frame_t*
+profile_capture(const profile_frame_t* frame)
+{
+    profile_frame_t* copy = malloc(sizeof(*copy) + frame->count * sizeof(*frame->nodes));
+
+    if (!copy)
+        return NULL;
+
+    *copy = *frame;
+    copy->nodes = (profile_node_t*)(copy + 1);
+
+    if (frame->count)
+        memcpy(copy->nodes, frame->nodes, frame->count * sizeof(*frame->nodes));
+
+    return copy;
+}
+
+void
+profile_release(profile_frame_t* frame)
+{
+    free(frame);
+}
+
+void
+profile_print(const profile_frame_t* frame, FILE* file)
+{
+    fprintf(file, "Frame %llu: %.3f ms\n", (unsigned long long)frame->index, time_to_ms(frame->duration));
+    fprintf(file, "%-40s %8s %10s %10s\n", "Zone", "Calls", "Incl ms", "Excl ms");
+
+    uint32_t thread = UINT32_MAX;
+
+    for (size_t i = 0; i < frame->count; ++i) {
+        const profile_node_t* node = &frame->nodes[i];
+
+        if (node->thread != thread) {
+            thread = node->thread;
+            fprintf(file, "Thread %u\n", thread);
+        }
+
+        int indent = 2 + 2 * (int)node->depth;
+
+        fprintf(file,
+                "%*s%-*.*s %8u %10.3f %10.3f\n",
+                indent, "",
+                40 - indent, 40 - indent, node->zone->name,
+                node->calls,
+                time_to_ms(node->inclusive),
+                time_to_ms(node->exclusive));
+    }
+}
+
+unsigned
+profile_dropped(void)
+{
+    unsigned dropped = 0;
+
+    for (profile__ring_t* ring = atomic_get(&gProfile.rings); ring; ring = ring->next)
+        dropped += atomic_get_relaxed(&ring->dropped);
+
+    return dropped;
+}
+
+const profile_zone_t*
+profile__begin(const profile_zone_t* zone)
+{
+    profile__ring_t* ring = profile__thread_ring();
+
+    if (!ring)
+        return zone;
+
+    /* Room for this zone's begin and end on top of the ends of the zones already open */
+    uint32_t head = ring->head;
+    uint32_t needed = ring->recorded + 2;
+
+    if (!ring->skip && head - ring->tail_cache + needed > PROFILE__RING_SIZE)
+        ring->tail_cache = atomic_get(&ring->tail);
+
+    if (ring->skip || head - ring->tail_cache + needed > PROFILE__RING_SIZE) {
+        ring->skip += 1;
+        atomic_add(&ring->dropped, 1);
+        return zone;
+    }
+
+    ring->events[head & (PROFILE__RING_SIZE - 1)] = (profile__event_t){zone, time_now()};
+    ring->recorded += 1;
+    atomic_set(&ring->head, head + 1);
+
+    return zone;
+}
+
+void
+profile__end(void)
+{
+    profile__ring_t* ring = this_ring;
+
+    if (!ring)
+        return;
+
+    if (ring->skip) {
+        ring->skip -= 1;
+        return;
+    }
+
+    if (!ring->recorded)
+        return;
+
+    uint32_t head = ring->head;
+    ring->recorded -= 1;
+
+    ring->events[head & (PROFILE__RING_SIZE - 1)] = (profile__event_t){NULL, time_now()};
+    atomic_set(&ring->head, head + 1);
+}
+
+
+static profile__ring_t*
+profile__thread_ring(void)
+{
+    if (this_ring)
+        return this_ring;
+
+    profile__ring_t* ring = calloc(1, sizeof(*ring));
+
+    if (!ring)
+        return NULL;
+
+    ring->thread = thread_id();
+    ring->next = atomic_get(&gProfile.rings);
+
+    while (!atomic_cas(&gProfile.rings, &ring->next, ring))
+        ;
+
+    this_ring = ring;
+    return ring;
+}
+
+/* Rebuilds the ring's tree from the events recorded up to now, later ones belong to the next frame */
+static void
+profile__aggregate(profile__ring_t* ring, uint64_t now)
+{
+    ring->count = 0;
+
+    /* Zones left open by the previous frame continue from the boundary */
+    for (uint32_t d = 0; d < ring->depth; ++d)
+        ring->open_node[d] = profile__child(ring, d ? ring->open_node[d - 1] : PROFILE__NONE, ring->open[d]);
+
+    uint32_t tail = ring->tail;
+    uint32_t head = atomic_get(&ring->head);
+
+    for (; tail != head; ++tail) {
+        const profile__event_t* event = &ring->events[tail & (PROFILE__RING_SIZE - 1)];
+
+        if (event->time > now)
+            break;
+
+        if (event->zone) {
+            uint32_t node = ring->depth < PROFILE__MAX_DEPTH
+                          ? profile__child(ring, ring->depth ? ring->open_node[ring->depth - 1] : PROFILE__NONE, event->zone)
+                          : PROFILE__NONE;
+
+            if (ring->ignored || node == PROFILE__NONE) {
+                ring->ignored += 1;
+                continue;
+            }
+
+            ring->open[ring->depth]       = event->zone;
+            ring->open_start[ring->depth] = event->time;
+            ring->open_begin[ring->depth] = event->time;
+            ring->open_node[ring->depth]  = node;
+            ring->depth += 1;
+        } else if (ring->ignored) {
+            ring->ignored -= 1;
+        } else if (ring->depth) {
+            ring->depth -= 1;
+
+            profile__node_t* node = &ring->nodes[ring->open_node[ring->depth]];
+            node->inclusive += event->time - ring->open_start[ring->depth];
+            node->calls += 1;
+
+            trace__zone(ring->thread, ring->open[ring->depth], ring->open_begin[ring->depth], event->time);
+        }
+    }
+
+    atomic_set(&ring->tail, tail);
+
+    for (uint32_t d = 0; d < ring->depth; ++d) {
+        ring->nodes[ring->open_node[d]].inclusive += now - ring->open_start[d];
+        ring->open_start[d] = now;
+    }
+
+    for (uint32_t i = 0; i < ring->count; ++i) {
+        const profile__node_t* node = &ring->nodes[i];
+
+        if (node->parent != PROFILE__NONE)
+            ring->nodes[node->parent].children += node->inclusive;
+    }
+}
+
+/* Finds or adds the zone's node under parent, PROFILE__NONE when the tree is full */
+static uint32_t
+profile__child(profile__ring_t* ring, uint32_t parent, const profile_zone_t* zone)
+{
+    uint32_t i = parent != PROFILE__NONE ? ring->nodes[parent].first : 0;
+
+    if (parent != PROFILE__NONE) {
+        for (; i != PROFILE__NONE; i = ring->nodes[i].next)
+            if (ring->nodes[i].zone == zone)
+                return i;
+    } else {
+        /* Roots aren't linked, there are few of them */
+        for (; i < ring->count; ++i)
+            if (ring->nodes[i].parent == PROFILE__NONE && ring->nodes[i].zone == zone)
+                return i;
+    }
+
+    if (ring->count == PROFILE__MAX_NODES)
+        return PROFILE__NONE;
+
+    uint32_t index = ring->count++;
+
+    ring->nodes[index] = (profile__node_t){zone, parent, PROFILE__NONE, PROFILE__NONE, PROFILE__NONE, 0, 0, 0};
+
+    if (parent != PROFILE__NONE) {
+        profile__node_t* p = &ring->nodes[parent];
+
+        if (p->last != PROFILE__NONE)
+            ring->nodes[p->last].next = index;
+        else
+            p->first = index;
+
+        p->last = index;
+    }
+
+    return index;
+}
+
+/* Appends node and its subtree to the frame, false when out of memory */
+static bool
+profile__emit(const profile__ring_t* ring, uint32_t node, uint32_t depth)
+{
+    if (gProfile.frame.count == gProfile.capacity) {
+        size_t capacity = gProfile.capacity ? gProfile.capacity * 2 : 256;
+        profile_node_t* nodes = realloc(gProfile.frame.nodes, capacity * sizeof(*nodes));
+
+        if (!nodes)
+            return false;
+
+        gProfile.frame.nodes = nodes;
+        gProfile.capacity = capacity;
+    }
+
+    const profile__node_t* n = &ring->nodes[node];
+
+    gProfile.frame.nodes[gProfile.frame.count++] = (profile_node_t){
+        n->zone,
+        ring->thread,
+        depth,
+        n->calls,
+        n->inclusive,
+        n->inclusive - n->children
+    };
+
+    for (uint32_t i = n->first; i != PROFILE__NONE; i = ring->nodes[i].next)
+        if (!profile__emit(ring, i, depth + 1))
+            return false;
+
+    return true;
+}
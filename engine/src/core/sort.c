@@ -0,0 +1,218 @@
+#include "engine/core/sort.h"
+#include "engine/core/thread.h"
+#include "engine/core/memory.h"
+#include "engine/core/log.h"
+
+#include <string.h>
+
+/* Below this many keys the cost of spawning threads outweighs the gain */
+#define SORT__MT_THRESHOLD  (1 << 16)
+#define SORT__MAX_CHUNKS    64
+
+typedef struct sort__chunk_t
+{
+    const void*     src_keys;
+    void*           dst_keys;
+    const uint32_t* src_vals;
+    uint32_t*       dst_vals;
+
+    size_t          begin;
+    size_t          end;
+    unsigned        shift;
+    unsigned        key_size;
+
+    /* Histogram of the chunk's digits, turned into scatter offsets before the scatter */
+    size_t          counts[256];
+} sort__chunk_t;
+
+static void sort__radix(void* keys, uint32_t* vals, size_t n, unsigned key_size, unsigned threads);
+static void sort__run(sort__chunk_t* chunks, unsigned count, void* (*job)(void*));
+static void* sort__count(void* arg);
+static void* sort__scatter(void* arg);
+
+void
+sort_radix_u32(uint32_t* keys, uint32_t* vals, size_t n)
+{
+    sort__radix(keys, vals, n, sizeof(*keys), 1);
+}
+
+void
+sort_radix_u64(uint64_t* keys, uint32_t* vals, size_t n)
+{
+    sort__radix(keys, vals, n, sizeof(*keys), 1);
+}
+
+void
+sort_radix_u32_mt(uint32_t* keys, uint32_t* vals, size_t n, unsigned threads)
+{
+    sort__radix(keys, vals, n, sizeof(*keys), threads ? threads : thread_count());
+}
+
+void
+sort_radix_u64_mt(uint64_t* keys, uint32_t* vals, size_t n, unsigned threads)
+{
+    sort__radix(keys, vals, n, sizeof(*keys), threads ? threads : thread_count());
+}
+
+
+static void
+sort__radix(void* keys, uint32_t* vals, size_t n, unsigned key_size, unsigned threads)
+{
+    if (n < 2)
+        return;
+
+    unsigned count = n < SORT__MT_THRESHOLD ? 1 : threads;
+
+    if (count > SORT__MAX_CHUNKS)
+        count = SORT__MAX_CHUNKS;
+
+    void* tmp_keys = malloc(n * key_size);
+    uint32_t* tmp_vals = vals ? malloc(n * sizeof(*vals)) : NULL;
+    sort__chunk_t* chunks = malloc(count * sizeof(*chunks));
+
+    if (!tmp_keys || (vals && !tmp_vals) || !chunks) {
+        loge("Failed to allocate radix sort buffers for %zu keys", n);
+        free(tmp_keys);
+        free(tmp_vals);
+        free(chunks);
+        return;
+    }
+
+    void* src_keys = keys;
+    void* dst_keys = tmp_keys;
+    uint32_t* src_vals = vals;
+    uint32_t* dst_vals = tmp_vals;
+
+    for (unsigned shift = 0; shift < key_size * 8; shift += 8) {
+        for (unsigned c = 0; c < count; ++c) {
+            chunks[c].src_keys = src_keys;
+            chunks[c].dst_keys = dst_keys;
+            chunks[c].src_vals = src_vals;
+            chunks[c].dst_vals = dst_vals;
+            chunks[c].begin    = n * c / count;
+            chunks[c].end      = n * (c + 1) / count;
+            chunks[c].shift    = shift;
+            chunks[c].key_size = key_size;
+        }
+
+        sort__run(chunks, count, sort__count);
+
+        /* Chunk c's keys with digit d go after every smaller digit and after
+         * the digit d keys of chunks before c, which keeps the sort stable */
+        bool trivial = false;
+        size_t offset = 0;
+
+        for (unsigned d = 0; d < 256; ++d) {
+            size_t start = offset;
+
+            for (unsigned c = 0; c < count; ++c) {
+                size_t t = chunks[c].counts[d];
+                chunks[c].counts[d] = offset;
+                offset += t;
+            }
+
+            if (offset - start == n)
+                trivial = true;
+        }
+
+        /* Every key has the same digit, the pass wouldn't change anything */
+        if (trivial)
+            continue;
+
+        sort__run(chunks, count, sort__scatter);
+
+        void* t = src_keys; src_keys = dst_keys; dst_keys = t;
+        uint32_t* v = src_vals; src_vals = dst_vals; dst_vals = v;
+    }
+
+    if (src_keys != keys) {
+        memcpy(keys, src_keys, n * key_size);
+
+        if (vals)
+            memcpy(vals, src_vals, n * sizeof(*vals));
+    }
+
+    free(tmp_keys);
+    free(tmp_vals);
+    free(chunks);
+}
+
+static void
+sort__run(sort__chunk_t* chunks, unsigned count, void* (*job)(void*))
+{
+    thread_t threads[SORT__MAX_CHUNKS];
+    bool spawned[SORT__MAX_CHUNKS] = {0};
+
+    for (unsigned c = 1; c < count; ++c)
+        spawned[c] = thread_create(&threads[c], job, &chunks[c]);
+
+    job(&chunks[0]);
+
+    /* Run anything that couldn't get its own thread on this one */
+    for (unsigned c = 1; c < count; ++c) {
+        if (spawned[c])
+            thread_join(threads[c]);
+        else
+            job(&chunks[c]);
+    }
+}
+
+static void*
+sort__count(void* arg)
+{
+    sort__chunk_t* chunk = arg;
+    size_t* counts = chunk->counts;
+    unsigned shift = chunk->shift;
+
+    memset(counts, 0, sizeof(chunk->counts));
+
+    if (chunk->key_size == sizeof(uint32_t)) {
+        const uint32_t* keys = chunk->src_keys;
+
+        for (size_t i = chunk->begin; i < chunk->end; ++i)
+            counts[(keys[i] >> shift) & 0xff] += 1;
+    } else {
+        const uint64_t* keys = chunk->src_keys;
+
+        for (size_t i = chunk->begin; i < chunk->end; ++i)
+            counts[(keys[i] >> shift) & 0xff] += 1;
+    }
+
+    return NULL;
+}
+
+static void*
+sort__scatter(void* arg)
+{
+    sort__chunk_t* chunk = arg;
+    size_t* offsets = chunk->counts;
+    unsigned shift = chunk->shift;
+    const uint32_t* src_vals = chunk->src_vals;
+    uint32_t* dst_vals = chunk->dst_vals;
+
+    if (chunk->key_size == sizeof(uint32_t)) {
+        const uint32_t* src = chunk->src_keys;
+        uint32_t* dst = chunk->dst_keys;
+
+        for (size_t i = chunk->begin; i < chunk->end; ++i) {
+            size_t j = offsets[(src[i] >> shift) & 0xff]++;
+            dst[j] = src[i];
+
+            if (src_vals)
+                dst_vals[j] = src_vals[i];
+        }
+    } else {
+        const uint64_t* src = chunk->src_keys;
+        uint64_t* dst = chunk->dst_keys;
+
+        for (size_t i = chunk->begin; i < chunk->end; ++i) {
+            size_t j = offsets[(src[i] >> shift) & 0xff]++;
+            dst[j] = src[i];
+
+            if (src_vals)
+                dst_vals[j] = src_vals[i];
+        }
+    }
+
+    return NULL;
+}
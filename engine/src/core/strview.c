@@ -0,0 +1,200 @@
+#include "engine/core/strview.h"
+#include "engine/core/cstring.h"
+
+#include <string.h>
+
+#define STRVIEW__IS_SPACE(c_) ((c_) == ' ' || ((c_) >= '\t' && (c_) <= '\r'))
+#define STRVIEW__IN_SET(set_, c_) ((set_)[(unsigned char)(c_) >> 3] & (1U << ((unsigned char)(c_) & 7)))
+
+strview_t
+strview_from(const char* c_str)
+{
+    return (strview_t){c_str, c_str ? strlen(c_str) : 0};
+}
+
+strview_t
+strview_from_n(const char* c_str, size_t len)
+{
+    return (strview_t){c_str, len};
+}
+
+strview_t
+strview_from_string(const string_t str)
+{
+    return (strview_t){str, string_len(str)};
+}
+
+string_t
+strview_to_string(strview_t sv)
+{
+    return string_create_n(sv.ptr, sv.len);
+}
+
+bool
+strview_empty(strview_t sv)
+{
+    return sv.len == 0;
+}
+
+bool
+strview_eq(strview_t a, strview_t b)
+{
+    return a.len == b.len && (a.ptr == b.ptr || memcmp(a.ptr, b.ptr, a.len) == 0);
+}
+
+bool
+strview_eq_cstr(strview_t a, const char* b)
+{
+    return strview_eq(a, strview_from(b));
+}
+
+int
+strview_cmp(strview_t a, strview_t b)
+{
+    size_t len = a.len < b.len ? a.len : b.len;
+    int cmp = len ? memcmp(a.ptr, b.ptr, len) : 0;
+
+    if (cmp)
+        return cmp;
+
+    return (a.len > b.len) - (a.len < b.len);
+}
+
+bool
+strview_starts_with(strview_t sv, strview_t prefix)
+{
+    return sv.len >= prefix.len && memcmp(sv.ptr, prefix.ptr, prefix.len) == 0;
+}
+
+bool
+strview_ends_with(strview_t sv, strview_t suffix)
+{
+    return sv.len >= suffix.len && memcmp(sv.ptr + sv.len - suffix.len, suffix.ptr, suffix.len) == 0;
+}
+
+size_t
+strview_find(strview_t sv, strview_t needle)
+{
+    const char* p = str_find(sv.ptr, sv.len, needle.ptr, needle.len);
+    return p ? (size_t)(p - sv.ptr) : STRVIEW_NPOS;
+}
+
+size_t
+strview_find_char(strview_t sv, char c)
+{
+    const char* p = sv.len ? memchr(sv.ptr, c, sv.len) : NULL;
+    return p ? (size_t)(p - sv.ptr) : STRVIEW_NPOS;
+}
+
+size_t
+strview_rfind_char(strview_t sv, char c)
+{
+    for (size_t i = sv.len; i-- > 0; )
+        if (sv.ptr[i] == c)
+            return i;
+
+    return STRVIEW_NPOS;
+}
+
+size_t
+strview_find_any(strview_t sv, const char* set)
+{
+    uint8_t bits[32] = {0};
+
+    for (; *set; ++set)
+        bits[(unsigned char)*set >> 3] |= 1U << ((unsigned char)*set & 7);
+
+    for (size_t i = 0; i < sv.len; ++i)
+        if (STRVIEW__IN_SET(bits, sv.ptr[i]))
+            return i;
+
+    return STRVIEW_NPOS;
+}
+
+strview_t
+strview_sub(strview_t sv, size_t pos, size_t len)
+{
+    if (pos > sv.len)
+        pos = sv.len;
+
+    if (len > sv.len - pos)
+        len = sv.len - pos;
+
+    return (strview_t){sv.ptr + pos, len};
+}
+
+strview_t
+strview_ltrim(strview_t sv)
+{
+    while (sv.len && STRVIEW__IS_SPACE(sv.ptr[0])) {
+        sv.ptr += 1;
+        sv.len -= 1;
+    }
+
+    return sv;
+}
+
+strview_t
+strview_rtrim(strview_t sv)
+{
+    while (sv.len && STRVIEW__IS_SPACE(sv.ptr[sv.len - 1]))
+        sv.len -= 1;
+
+    return sv;
+}
+
+strview_t
+strview_trim(strview_t sv)
+{
+    return strview_rtrim(strview_ltrim(sv));
+}
+
+bool
+strview_split(strview_t sv, char delim, strview_t* head, strview_t* tail)
+{
+    size_t i = strview_find_char(sv, delim);
+
+    if (i == STRVIEW_NPOS) {
+        if (head) *head = sv;
+        if (tail) *tail = (strview_t){sv.ptr + sv.len, 0};
+        return false;
+    }
+
+    if (head) *head = (strview_t){sv.ptr, i};
+    if (tail) *tail = (strview_t){sv.ptr + i + 1, sv.len - i - 1};
+    return true;
+}
+
+void
+strview_tok_init(strview_tok_t* it, strview_t sv, const char* delims)
+{
+    it->rest = sv;
+    memset(it->delims, 0, sizeof(it->delims));
+
+    for (; *delims; ++delims)
+        it->delims[(unsigned char)*delims >> 3] |= 1U << ((unsigned char)*delims & 7);
+}
+
+bool
+strview_tok_next(strview_tok_t* it, strview_t* token)
+{
+    const char* p = it->rest.ptr;
+    const char* end = p + it->rest.len;
+
+    while (p < end && STRVIEW__IN_SET(it->delims, *p))
+        p += 1;
+
+    if (p == end) {
+        it->rest = (strview_t){end, 0};
+        return false;
+    }
+
+    const char* start = p;
+
+    while (p < end && !STRVIEW__IN_SET(it->delims, *p))
+        p += 1;
+
+    *token = (strview_t){start, (size_t)(p - start)};
+    it->rest = (strview_t){p, (size_t)(end - p)};
+    return true;
+}
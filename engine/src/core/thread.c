@@ -0,0 +1,116 @@
+#define _POSIX_C_SOURCE 199309L /* nanosleep */
+#include "engine/core/thread.h"
+#include "engine/core/log.h"
+
+#include <sched.h>
+#include <time.h>
+
+static uint32_t next_thread_id = 0;
+static THREAD_LOCAL uint32_t this_thread_id = UINT32_MAX;
+
+bool
+thread_create(thread_t* thread, void* (*fn)(void* arg), void* arg)
+{
+    if (pthread_create(thread, NULL, fn, arg) != 0) {
+        loge("Failed to create thread");
+        return false;
+    }
+
+    return true;
+}
+
+void*
+thread_join(thread_t thread)
+{
+    void* result = NULL;
+    pthread_join(thread, &result);
+    return result;
+}
+
+uint32_t
+thread_id(void)
+{
+    if (this_thread_id == UINT32_MAX)
+        this_thread_id = atomic_add(&next_thread_id, 1);
+
+    return this_thread_id;
+}
+
+unsigned
+thread_count(void)
+{
+#if PLATFORM_POSIX
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (unsigned)count : 1;
+#else
+    return 1;
+#endif
+}
+
+void
+thread_yield(void)
+{
+    sched_yield();
+}
+
+void
+thread_sleep(uint64_t ns)
+{
+    struct timespec ts = {(time_t)(ns / 1000000000ULL), (long)(ns % 1000000000ULL)};
+    while (nanosleep(&ts, &ts) != 0)
+        ;
+}
+
+void
+mutex_init(mutex_t* mutex)
+{
+    pthread_mutex_init(mutex, NULL);
+}
+
+void
+mutex_destroy(mutex_t* mutex)
+{
+    pthread_mutex_destroy(mutex);
+}
+
+void
+mutex_lock(mutex_t* mutex)
+{
+    pthread_mutex_lock(mutex);
+}
+
+void
+mutex_unlock(mutex_t* mutex)
+{
+    pthread_mutex_unlock(mutex);
+}
+
+void
+cond_init(cond_t* cond)
+{
+    pthread_cond_init(cond, NULL);
+}
+
+void
+cond_destroy(cond_t* cond)
+{
+    pthread_cond_destroy(cond);
+}
+
+void
+cond_wait(cond_t* cond, mutex_t* mutex)
+{
+    pthread_cond_wait(cond, mutex);
+}
+
+void
+cond_signal(cond_t* cond)
+{
+    pthread_cond_signal(cond);
+}
+
+void
+cond_broadcast(cond_t* cond)
+{
+    pthread_cond_broadcast(cond);
+}
@@ -1,14 +1,17 @@
+#define _POSIX_C_SOURCE 200112L /* clock_gettime, localtime_r */
 #include "engine/core/timer.h"
-#include "engine/core/base.h"
+#include "engine/core/thread.h"
 
 #include <stdio.h>
 
 #if PLATFORM_WINDOWS
 
-    typedef long time_t;
+    #include <windows.h>
 
     /* https://stackoverflow.com/a/31335254 */
 
+    #define CLOCK_REALTIME 0
+
     struct timespec { long tv_sec; long tv_nsec; };
 
     static int clock_gettime(int, struct timespec *spec)
@@ -26,49 +29,172 @@
     #include <time.h>
 #endif /* PLATFORM_WINDOWS */
 
+#if defined(__x86_64__) || defined(__i386__)
+    #include <cpuid.h>
+    #define TIMER__TSC 1
+#else
+    #define TIMER__TSC 0
+#endif
+
+#define TIMER__CALIBRATE_NS (10 * TIME_NS_PER_MS)
+
+static struct
+{
+    bool     fast;
+    uint64_t tsc_base;
+    uint64_t ns_base;
+    uint64_t mult;      /* ns per tick in 32.32 fixed point */
+} gTsc = {false, 0, 0, 0};
+
+static uint64_t time__clock(void);
+static uint64_t time__scale(uint64_t ticks, uint64_t mult);
+
+#if TIMER__TSC
+static inline uint64_t
+time__rdtsc(void)
+{
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+#endif
 
-double
+uint64_t
 time_now(void)
 {
-    struct timespec ts = {0};
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return (double)ts.tv_sec + ((double)ts.tv_nsec * 1.0e9);
+#if TIMER__TSC
+    /* Acquire, pairs with the calibration's release so the bases and mult are seen */
+    if (atomic_get(&gTsc.fast))
+        return gTsc.ns_base + time__scale(time__rdtsc() - gTsc.tsc_base, gTsc.mult);
+#endif
+
+    return time__clock();
 }
 
-timer_t
+bool
+time_calibrate(void)
+{
+#if TIMER__TSC
+    unsigned eax, ebx, ecx, edx;
+
+    /* Without an invariant TSC the tick rate follows frequency scaling */
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1U << 8)))
+        return false;
+
+    uint64_t ns0 = time__clock();
+    uint64_t tsc0 = time__rdtsc();
+    uint64_t ns1, tsc1;
+
+    do {
+        ns1 = time__clock();
+        tsc1 = time__rdtsc();
+    } while (ns1 - ns0 < TIMER__CALIBRATE_NS);
+
+    /* A preempted loop can overshoot, but by seconds before the shift below overflows */
+    if (tsc1 <= tsc0 || ns1 - ns0 > UINT32_MAX)
+        return false;
+
+    gTsc.mult     = ((ns1 - ns0) << 32) / (tsc1 - tsc0);
+    gTsc.tsc_base = tsc1;
+    gTsc.ns_base  = ns1;
+
+    atomic_set(&gTsc.fast, true);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool
+time_is_fast(void)
+{
+    return atomic_get_relaxed(&gTsc.fast);
+}
+
+uint64_t
 timer_start(void)
 {
     return time_now();
 }
 
-double
-timer_split(timer_t* timer)
+uint64_t
+timer_read(uint64_t timer)
+{
+    return time_now() - timer;
+}
+
+uint64_t
+timer_split(uint64_t* timer)
 {
-    const double now = time_now();
-    const double elapsed = now - *timer;
+    const uint64_t now = time_now();
+    const uint64_t elapsed = now - *timer;
 
     *timer = now;
     return elapsed;
 }
 
-double
-timer_read(const timer_t timer)
+uint64_t
+timer_stop(uint64_t* timer)
 {
-    return time_now() - timer;
+    const uint64_t elapsed = time_now() - *timer;
+
+    *timer = 0;
+    return elapsed;
 }
 
 void
 time_stamp(char* buf)
 {
+    /* Wall clock for both the seconds and the milliseconds, they used to come from different clocks */
+    struct timespec ts = {0};
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    time_t now = ts.tv_sec;
+    struct tm tm;
+
+#if PLATFORM_WINDOWS
+    localtime_s(&tm, &now);
+#else
+    localtime_r(&now, &tm); /* Sinks call this from several threads */
+#endif
+
+    size_t len = strftime(buf, 16, "%H:%M:%S", &tm);
+    snprintf(buf + len, 16 - len, ".%03ld", (long)(ts.tv_nsec / 1000000));
+}
+
+
+static uint64_t
+time__clock(void)
+{
+#if PLATFORM_WINDOWS
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+
+    uint64_t f = (uint64_t)freq.QuadPart;
+    uint64_t c = (uint64_t)count.QuadPart;
+
+    return c / f * TIME_NS_PER_SEC + c % f * TIME_NS_PER_SEC / f;
+#else
     struct timespec ts = {0};
     clock_gettime(CLOCK_MONOTONIC, &ts);
-    long milli = (long)(((double)ts.tv_nsec / 1.0e6) + 0.5);
+    return (uint64_t)ts.tv_sec * TIME_NS_PER_SEC + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/* (ticks * mult) >> 32, mult being 32.32 fixed point */
+static uint64_t
+time__scale(uint64_t ticks, uint64_t mult)
+{
+#if defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 timer__u128;
 
-    time_t now;
-    time(&now);
-    struct tm* tm = localtime(&now);
+    return (uint64_t)(((timer__u128)ticks * mult) >> 32);
+#else
+    /* Split into 32-bit halves, the bits shifted out only come from the low product */
+    uint64_t th = ticks >> 32, tl = ticks & UINT32_MAX;
+    uint64_t mh = mult >> 32,  ml = mult & UINT32_MAX;
 
-    strftime(buf, 16, "%H:%M:%S", tm);
-    int count = snprintf(buf, 16, "%s.%3ld", buf, milli);
-    buf[count] = '\0';
+    return (th * mh << 32) + th * ml + tl * mh + (tl * ml >> 32);
+#endif
 }
@@ -0,0 +1,333 @@
+#include "engine/core/timerwheel.h"
+#include "engine/core/vector.h"
+#include "engine/core/memory.h"
+#include "engine/core/log.h"
+
+#define TIMERWHEEL__NONE    UINT32_MAX
+#define TIMERWHEEL__FIRING  (TIMERWHEEL__LISTS)         /* In no list, its callback is running */
+#define TIMERWHEEL__FREE    (TIMERWHEEL__LISTS + 1)
+
+#define TIMERWHEEL__MASK    ((uint64_t)TIMERWHEEL_SLOTS - 1)
+
+struct timerwheel__node_t
+{
+    uint64_t   expires;     /* Tick */
+    uint64_t   interval;    /* Ticks, 0 for a one-shot timer */
+    timer_fn_t fn;
+    void*      arg;
+    uint32_t   next;
+    uint32_t   prev;
+    uint32_t   generation;  /* Bumped when the node is freed, so old ids stop matching */
+    uint32_t   list;
+};
+
+static void     timerwheel__insert(timerwheel_t* wheel, uint32_t i);
+static void     timerwheel__unlink(timerwheel_t* wheel, uint32_t i);
+static void     timerwheel__release(timerwheel_t* wheel, uint32_t i);
+static void     timerwheel__cascade(timerwheel_t* wheel, uint32_t list);
+static uint64_t timerwheel__next(const timerwheel_t* wheel);
+static size_t   timerwheel__tick(timerwheel_t* wheel);
+static uint32_t timerwheel__find(const timerwheel_t* wheel, timer_id_t id);
+
+timerwheel_t*
+timerwheel_create(uint64_t tick_ns, uint64_t now)
+{
+    timerwheel_t* wheel = calloc(1, sizeof(*wheel));
+
+    if (!wheel) {
+        loge("Failed to create timer wheel");
+        return NULL;
+    }
+
+    vector_init(wheel->nodes);
+
+    if (!wheel->nodes) {
+        loge("Failed to create timer wheel");
+        free(wheel);
+        return NULL;
+    }
+
+    wheel->tick_ns = tick_ns ? tick_ns : 1;
+    wheel->start   = now;
+    wheel->free    = TIMERWHEEL__NONE;
+
+    for (size_t i = 0; i < TIMERWHEEL__LISTS; ++i)
+        wheel->lists[i] = TIMERWHEEL__NONE;
+
+    return wheel;
+}
+
+void
+timerwheel_destroy(timerwheel_t* wheel)
+{
+    if (!wheel)
+        return;
+
+    vector_free(wheel->nodes);
+    free(wheel);
+}
+
+timer_id_t
+timerwheel_schedule(timerwheel_t* wheel, uint64_t delay_ns, uint64_t interval_ns, timer_fn_t fn, void* arg)
+{
+    uint32_t i = wheel->free;
+
+    if (i != TIMERWHEEL__NONE) {
+        wheel->free = wheel->nodes[i].next;
+    } else {
+        if (vector_size(wheel->nodes) >= TIMERWHEEL__NONE) {
+            log_once(loge, "Timer wheel is full, can't schedule more than %u timers", TIMERWHEEL__NONE);
+            return 0;
+        }
+
+        i = (uint32_t)vector_size(wheel->nodes);
+        vector_push(wheel->nodes, (timerwheel__node_t){0});
+        wheel->nodes[i].generation = 1;
+    }
+
+    /* Rounded up, a timer never fires early, and at the soonest on the next tick */
+    uint64_t delay = (delay_ns + wheel->tick_ns - 1) / wheel->tick_ns;
+    uint64_t interval = (interval_ns + wheel->tick_ns - 1) / wheel->tick_ns;
+
+    timerwheel__node_t* node = &wheel->nodes[i];
+    node->expires  = wheel->now + (delay ? delay : 1);
+    node->interval = interval;
+    node->fn       = fn;
+    node->arg      = arg;
+
+    timerwheel__insert(wheel, i);
+    wheel->count += 1;
+
+    return ((uint64_t)node->generation << 32) | i;
+}
+
+bool
+timerwheel_cancel(timerwheel_t* wheel, timer_id_t id)
+{
+    uint32_t i = timerwheel__find(wheel, id);
+
+    if (i == TIMERWHEEL__NONE)
+        return false;
+
+    if (wheel->nodes[i].list != TIMERWHEEL__FIRING)
+        timerwheel__unlink(wheel, i);
+
+    timerwheel__release(wheel, i);
+    return true;
+}
+
+bool
+timerwheel_pending(const timerwheel_t* wheel, timer_id_t id)
+{
+    return timerwheel__find(wheel, id) != TIMERWHEEL__NONE;
+}
+
+uint64_t
+timerwheel_next_time(const timerwheel_t* wheel)
+{
+    if (!wheel->count)
+        return UINT64_MAX;
+
+    return wheel->start + timerwheel__next(wheel) * wheel->tick_ns;
+}
+
+size_t
+timerwheel_advance(timerwheel_t* wheel, uint64_t now)
+{
+    uint64_t target = now > wheel->start ? (now - wheel->start) / wheel->tick_ns : 0;
+    size_t fired = 0;
+
+    while (wheel->now < target) {
+        if (!wheel->count) {
+            wheel->now = target;
+            break;
+        }
+
+        uint64_t next = timerwheel__next(wheel);
+
+        if (next > target) {
+            wheel->now = target;
+            break;
+        }
+
+        wheel->now = next;
+        fired += timerwheel__tick(wheel);
+    }
+
+    return fired;
+}
+
+
+/* Files the node by the highest bit its expiry differs from now in, 6 bits a level */
+static void
+timerwheel__insert(timerwheel_t* wheel, uint32_t i)
+{
+    timerwheel__node_t* node = &wheel->nodes[i];
+    uint64_t diff = node->expires ^ wheel->now;
+    uint32_t level = diff ? (63 - __builtin_clzll(diff)) / TIMERWHEEL_SLOT_BITS : 0;
+    uint32_t list;
+
+    if (level < TIMERWHEEL_LEVELS) {
+        uint32_t slot = (node->expires >> (level * TIMERWHEEL_SLOT_BITS)) & TIMERWHEEL__MASK;
+
+        list = level * TIMERWHEEL_SLOTS + slot;
+        wheel->occupied[level] |= (uint64_t)1 << slot;
+    } else {
+        list = TIMERWHEEL__OVERFLOW;
+    }
+
+    node->list = list;
+    node->prev = TIMERWHEEL__NONE;
+    node->next = wheel->lists[list];
+
+    if (node->next != TIMERWHEEL__NONE)
+        wheel->nodes[node->next].prev = i;
+
+    wheel->lists[list] = i;
+}
+
+static void
+timerwheel__unlink(timerwheel_t* wheel, uint32_t i)
+{
+    timerwheel__node_t* node = &wheel->nodes[i];
+
+    if (node->prev != TIMERWHEEL__NONE)
+        wheel->nodes[node->prev].next = node->next;
+    else
+        wheel->lists[node->list] = node->next;
+
+    if (node->next != TIMERWHEEL__NONE)
+        wheel->nodes[node->next].prev = node->prev;
+
+    if (node->list < TIMERWHEEL__OVERFLOW && wheel->lists[node->list] == TIMERWHEEL__NONE)
+        wheel->occupied[node->list / TIMERWHEEL_SLOTS] &= ~((uint64_t)1 << (node->list % TIMERWHEEL_SLOTS));
+
+    node->list = TIMERWHEEL__FIRING;
+}
+
+static void
+timerwheel__release(timerwheel_t* wheel, uint32_t i)
+{
+    timerwheel__node_t* node = &wheel->nodes[i];
+
+    node->generation = node->generation == UINT32_MAX ? 1 : node->generation + 1;
+    node->list = TIMERWHEEL__FREE;
+    node->next = wheel->free;
+    wheel->free = i;
+    wheel->count -= 1;
+}
+
+/* Refiles every node of the list against the current tick, they all land on lower levels */
+static void
+timerwheel__cascade(timerwheel_t* wheel, uint32_t list)
+{
+    uint32_t i = wheel->lists[list];
+
+    wheel->lists[list] = TIMERWHEEL__NONE;
+
+    if (list < TIMERWHEEL__OVERFLOW)
+        wheel->occupied[list / TIMERWHEEL_SLOTS] &= ~((uint64_t)1 << (list % TIMERWHEEL_SLOTS));
+
+    while (i != TIMERWHEEL__NONE) {
+        uint32_t next = wheel->nodes[i].next;
+        timerwheel__insert(wheel, i);
+        i = next;
+    }
+}
+
+/*
+ * The next tick anything expires or cascades on. Occupied slots of a level all
+ * lie ahead of the current one, and the lowest non-empty level comes first
+ */
+static uint64_t
+timerwheel__next(const timerwheel_t* wheel)
+{
+    for (uint32_t level = 0; level < TIMERWHEEL_LEVELS; ++level) {
+        if (!wheel->occupied[level])
+            continue;
+
+        uint32_t shift = level * TIMERWHEEL_SLOT_BITS;
+        uint64_t slot = (uint64_t)__builtin_ctzll(wheel->occupied[level]);
+
+        return (wheel->now >> shift >> TIMERWHEEL_SLOT_BITS << TIMERWHEEL_SLOT_BITS | slot) << shift;
+    }
+
+    return (wheel->now | (((uint64_t)1 << (TIMERWHEEL_LEVELS * TIMERWHEEL_SLOT_BITS)) - 1)) + 1;
+}
+
+static size_t
+timerwheel__tick(timerwheel_t* wheel)
+{
+    uint64_t now = wheel->now;
+
+    /* Top down, so a timer cascading from a higher level can cascade again or expire on this same tick */
+    if (!(now & (((uint64_t)1 << (TIMERWHEEL_LEVELS * TIMERWHEEL_SLOT_BITS)) - 1)))
+        timerwheel__cascade(wheel, TIMERWHEEL__OVERFLOW);
+
+    for (uint32_t level = TIMERWHEEL_LEVELS - 1; level > 0; --level) {
+        if (now & (((uint64_t)1 << (level * TIMERWHEEL_SLOT_BITS)) - 1))
+            continue;
+
+        uint32_t slot = (now >> (level * TIMERWHEEL_SLOT_BITS)) & TIMERWHEEL__MASK;
+
+        if (wheel->occupied[level] & ((uint64_t)1 << slot))
+            timerwheel__cascade(wheel, level * TIMERWHEEL_SLOTS + slot);
+    }
+
+    uint32_t slot = now & TIMERWHEEL__MASK;
+
+    if (!(wheel->occupied[0] & ((uint64_t)1 << slot)))
+        return 0;
+
+    /* Detached first, callbacks may schedule onto this slot again or cancel timers that are yet to fire */
+    wheel->lists[TIMERWHEEL__EXPIRING] = wheel->lists[slot];
+    wheel->lists[slot] = TIMERWHEEL__NONE;
+    wheel->occupied[0] &= ~((uint64_t)1 << slot);
+
+    for (uint32_t i = wheel->lists[TIMERWHEEL__EXPIRING]; i != TIMERWHEEL__NONE; i = wheel->nodes[i].next)
+        wheel->nodes[i].list = TIMERWHEEL__EXPIRING;
+
+    size_t fired = 0;
+
+    while (wheel->lists[TIMERWHEEL__EXPIRING] != TIMERWHEEL__NONE) {
+        uint32_t i = wheel->lists[TIMERWHEEL__EXPIRING];
+
+        timerwheel__unlink(wheel, i);
+
+        /* The callback may grow the node vector, nothing is held across it but the index */
+        uint32_t generation = wheel->nodes[i].generation;
+        wheel->nodes[i].fn(wheel->nodes[i].arg);
+        fired += 1;
+
+        timerwheel__node_t* node = &wheel->nodes[i];
+
+        if (node->generation != generation)
+            continue;
+
+        if (node->interval) {
+            node->expires = now + node->interval;
+            timerwheel__insert(wheel, i);
+        } else {
+            timerwheel__release(wheel, i);
+        }
+    }
+
+    return fired;
+}
+
+static uint32_t
+timerwheel__find(const timerwheel_t* wheel, timer_id_t id)
+{
+    uint32_t i = (uint32_t)id;
+    uint32_t generation = (uint32_t)(id >> 32);
+
+    if (!generation || i >= vector_size(wheel->nodes))
+        return TIMERWHEEL__NONE;
+
+    const timerwheel__node_t* node = &wheel->nodes[i];
+
+    if (node->generation != generation || node->list == TIMERWHEEL__FREE)
+        return TIMERWHEEL__NONE;
+
+    return i;
+}
@@ -0,0 +1,493 @@
+#define MEMORY_RECURSION_GUARD /* memory.c reports into the trace, which stays off the tracked allocator */
+#include "engine/core/trace.h"
+#include "engine/core/log.h"
+#include "engine/core/memory.h"
+#include "engine/core/thread.h"
+#include "engine/core/timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TRACE__TEXT       96
+#define TRACE__PATH_SIZE  256
+#define TRACE__COOLDOWN   TIME_NS_PER_SEC   /* Least time between two hitch exports */
+#define TRACE__FRAMES_TID 0xffff            /* Track the frame slices are drawn on */
+
+enum
+{
+    TRACE__ZONE = 1,
+    TRACE__LOG,
+    TRACE__ALLOC,
+    TRACE__FRAME
+};
+
+typedef struct trace__event_t
+{
+    uint64_t      time;
+    uint64_t      duration;     /* Zones and frames */
+    uint64_t      size;         /* Bytes allocated, memory in use at a frame boundary */
+    uint64_t      index;        /* Frames */
+    const char*   name;         /* Zone name, log function */
+    const char*   file;
+    int           line;
+    uint32_t      thread;
+    unsigned char type;
+    unsigned char level;
+    char          text[TRACE__TEXT];
+} trace__event_t;
+
+static void trace__log_write(log_sink_t* sink, const log_message_t* message);
+static void trace__log_flush(log_sink_t* sink);
+
+static struct
+{
+    mutex_t         lock;       /* Guards the ring */
+    bool            active;
+    trace__event_t* events;
+    size_t          capacity;
+    uint64_t        head;       /* Events recorded so far */
+    uint64_t        start;
+    size_t          alloc_spike;
+    uint64_t        hitch;      /* ns, 0 when disabled */
+    char            prefix[TRACE__PATH_SIZE];
+
+    /* trace_frame only */
+    uint64_t        frame;
+    uint64_t        last_frame;
+    uint64_t        last_export;
+
+    log_sink_t      sink;
+
+    /* Hitch exports are written on a thread of their own, the frame only waits for the copy */
+    struct {
+        mutex_t         lock;
+        cond_t          wake;
+        thread_t        thread;
+        bool            started;
+        bool            stop;
+        trace__event_t* events;     /* The snapshot being written, NULL when idle */
+        size_t          count;
+        uint64_t        base;
+        uint64_t        frame;
+        char            path[TRACE__PATH_SIZE + 32];
+    } writer;
+} gTrace = {MUTEX_INIT, false, NULL, 0, 0, 0, 0, 0, {0}, 0, 0, 0,
+            {trace__log_write, trace__log_flush, NULL, LOG_LEVEL_MAX},
+            {MUTEX_INIT, COND_INIT, 0, false, false, NULL, 0, 0, 0, {0}}};
+
+static trace__event_t* trace__snapshot(size_t* count, uint64_t* base);
+static bool trace__write(const char* path, const trace__event_t* events, size_t count, uint64_t base);
+static void trace__hitch(uint64_t frame);
+static void* trace__writer_main(void* arg);
+static void trace__push(const trace__event_t* event);
+static void trace__write_event(FILE* file, const trace__event_t* event, uint64_t base);
+static void trace__json_string(FILE* file, const char* str, size_t len);
+
+bool
+trace_start(const trace_props_t* props)
+{
+    trace_stop();
+
+    size_t capacity = props->capacity ? props->capacity : TRACE_DEFAULT_CAPACITY;
+    trace__event_t* events = malloc(capacity * sizeof(*events));
+
+    if (!events) {
+        loge("Failed to allocate a trace of %zu events", capacity);
+        return false;
+    }
+
+    mutex_lock(&gTrace.lock);
+
+    gTrace.events      = events;
+    gTrace.capacity    = capacity;
+    gTrace.head        = 0;
+    gTrace.start       = time_now();
+    gTrace.alloc_spike = props->alloc_spike ? props->alloc_spike : TRACE_DEFAULT_ALLOC_SPIKE;
+    gTrace.hitch       = props->hitch_ms > 0.0 ? time_from_ms(props->hitch_ms) : 0;
+    gTrace.last_frame  = gTrace.start;
+    gTrace.last_export = 0;
+
+    snprintf(gTrace.prefix, sizeof(gTrace.prefix), "%s", props->hitch_prefix ? props->hitch_prefix : "hitch_");
+
+    atomic_set(&gTrace.active, true);
+    mutex_unlock(&gTrace.lock);
+
+    if (gTrace.hitch) {
+        gTrace.writer.stop = false;
+        gTrace.writer.started = thread_create(&gTrace.writer.thread, trace__writer_main, NULL);
+    }
+
+    log_sink_add(&gTrace.sink);
+    return true;
+}
+
+void
+trace_stop(void)
+{
+    if (!atomic_get(&gTrace.active))
+        return;
+
+    log_sink_remove(&gTrace.sink);
+
+    /* Lets an export in progress finish */
+    if (gTrace.writer.started) {
+        mutex_lock(&gTrace.writer.lock);
+        gTrace.writer.stop = true;
+        cond_signal(&gTrace.writer.wake);
+        mutex_unlock(&gTrace.writer.lock);
+
+        thread_join(gTrace.writer.thread);
+        gTrace.writer.started = false;
+    }
+
+    mutex_lock(&gTrace.lock);
+
+    atomic_set(&gTrace.active, false);
+    free(gTrace.events);
+    gTrace.events = NULL;
+    gTrace.capacity = 0;
+
+    mutex_unlock(&gTrace.lock);
+}
+
+bool
+trace_export(const char* path)
+{
+    size_t count;
+    uint64_t base;
+    trace__event_t* events = trace__snapshot(&count, &base);
+
+    if (!events) {
+        if (!atomic_get(&gTrace.active))
+            logw("Can't export a trace to '%s', tracing isn't running", path);
+
+        return false;
+    }
+
+    bool ok = trace__write(path, events, count, base);
+
+    free(events);
+    return ok;
+}
+
+void
+trace_frame(void)
+{
+    if (!atomic_get_relaxed(&gTrace.active))
+        return;
+
+    uint64_t now = time_now();
+    memory_stats_t stats;
+    memory_stats(&stats);
+
+    gTrace.frame += 1;
+
+    trace__event_t event = {0};
+    event.type     = TRACE__FRAME;
+    event.time     = gTrace.last_frame;
+    event.duration = now - gTrace.last_frame;
+    event.size     = stats.current;
+    event.index    = gTrace.frame;
+    event.thread   = thread_id();
+
+    trace__push(&event);
+    gTrace.last_frame = now;
+
+    /* profile_frame runs first in window_flip, the frame's zones are already in */
+    if (gTrace.hitch && event.duration > gTrace.hitch && now - gTrace.last_export >= TRACE__COOLDOWN) {
+        trace__hitch(gTrace.frame);
+        gTrace.last_export = time_now();
+    }
+}
+
+void
+trace__zone(uint32_t thread, const profile_zone_t* zone, uint64_t begin, uint64_t end)
+{
+    if (!atomic_get_relaxed(&gTrace.active))
+        return;
+
+    trace__event_t event = {0};
+    event.type     = TRACE__ZONE;
+    event.time     = begin;
+    event.duration = end - begin;
+    event.name     = zone->name;
+    event.file     = zone->file;
+    event.line     = zone->line;
+    event.thread   = thread;
+
+    trace__push(&event);
+}
+
+void
+trace__alloc(size_t size, const char* file, int line)
+{
+    if (!atomic_get(&gTrace.active) || size < gTrace.alloc_spike)
+        return;
+
+    trace__event_t event = {0};
+    event.type   = TRACE__ALLOC;
+    event.time   = time_now();
+    event.size   = size;
+    event.file   = file;
+    event.line   = line;
+    event.thread = thread_id();
+
+    trace__push(&event);
+}
+
+
+/* Copied out first, the producers only wait for a memcpy rather than the whole file. NULL when not tracing */
+static trace__event_t*
+trace__snapshot(size_t* count, uint64_t* base)
+{
+    mutex_lock(&gTrace.lock);
+
+    if (!gTrace.active) {
+        mutex_unlock(&gTrace.lock);
+        return NULL;
+    }
+
+    size_t n = gTrace.head < gTrace.capacity ? (size_t)gTrace.head : gTrace.capacity;
+    size_t first = (size_t)((gTrace.head - n) % gTrace.capacity);
+    trace__event_t* events = malloc(n * sizeof(*events) + 1);
+
+    if (events) {
+        size_t split = gTrace.capacity - first < n ? gTrace.capacity - first : n;
+
+        memcpy(events, gTrace.events + first, split * sizeof(*events));
+        memcpy(events + split, gTrace.events, (n - split) * sizeof(*events));
+    }
+
+    *count = n;
+    *base = gTrace.start;
+
+    mutex_unlock(&gTrace.lock);
+
+    if (!events)
+        loge("Failed to allocate %zu trace events for export", n);
+
+    return events;
+}
+
+static bool
+trace__write(const char* path, const trace__event_t* events, size_t count, uint64_t base)
+{
+    FILE* file = fopen(path, "w");
+
+    if (!file) {
+        loge("Failed to open trace file '%s'", path);
+        return false;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"engine\"}},\n");
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"Frames\"}}", TRACE__FRAMES_TID);
+
+    for (size_t i = 0; i < count; ++i) {
+        fputs(",\n", file);
+        trace__write_event(file, &events[i], base);
+    }
+
+    fprintf(file, "\n]}\n");
+
+    bool ok = !ferror(file);
+
+    fclose(file);
+
+    if (!ok)
+        loge("Failed to write trace file '%s'", path);
+
+    return ok;
+}
+
+/* Hands a snapshot to the writer, a hitch while it's still writing the last one isn't exported */
+static void
+trace__hitch(uint64_t frame)
+{
+    if (!gTrace.writer.started)
+        return;
+
+    mutex_lock(&gTrace.writer.lock);
+    bool busy = gTrace.writer.events != NULL;
+    mutex_unlock(&gTrace.writer.lock);
+
+    if (busy) {
+        logw("Frame %llu hitched while the last hitch was still being written, not exported", (unsigned long long)frame);
+        return;
+    }
+
+    size_t count;
+    uint64_t base;
+    trace__event_t* events = trace__snapshot(&count, &base);
+
+    if (!events)
+        return;
+
+    mutex_lock(&gTrace.writer.lock);
+
+    gTrace.writer.events = events;
+    gTrace.writer.count  = count;
+    gTrace.writer.base   = base;
+    gTrace.writer.frame  = frame;
+    snprintf(gTrace.writer.path, sizeof(gTrace.writer.path), "%s%llu.json", gTrace.prefix, (unsigned long long)frame);
+
+    cond_signal(&gTrace.writer.wake);
+    mutex_unlock(&gTrace.writer.lock);
+}
+
+static void*
+trace__writer_main(void* arg)
+{
+    UNUSED(arg);
+
+    mutex_lock(&gTrace.writer.lock);
+
+    for (;;) {
+        while (!gTrace.writer.events && !gTrace.writer.stop)
+            cond_wait(&gTrace.writer.wake, &gTrace.writer.lock);
+
+        if (!gTrace.writer.events)
+            break;
+
+        /* Only trace__hitch writes these and it waits for events to be NULL again */
+        mutex_unlock(&gTrace.writer.lock);
+
+        if (trace__write(gTrace.writer.path, gTrace.writer.events, gTrace.writer.count, gTrace.writer.base))
+            logw("Frame %llu hitched, trace written to '%s'", (unsigned long long)gTrace.writer.frame, gTrace.writer.path);
+
+        free(gTrace.writer.events);
+
+        mutex_lock(&gTrace.writer.lock);
+        gTrace.writer.events = NULL;
+    }
+
+    mutex_unlock(&gTrace.writer.lock);
+    return NULL;
+}
+
+static void
+trace__log_write(log_sink_t* sink, const log_message_t* message)
+{
+    UNUSED(sink);
+
+    trace__event_t event = {0};
+    event.type   = TRACE__LOG;
+    event.time   = message->time;
+    event.name   = message->func;
+    event.file   = message->file;
+    event.line   = message->line;
+    event.level  = (unsigned char)message->level;
+    event.thread = message->thread;
+
+    size_t len = message->len;
+
+    /* Cut before a partial UTF-8 sequence, the JSON has to stay valid */
+    if (len > TRACE__TEXT) {
+        len = TRACE__TEXT;
+
+        while (len && ((unsigned char)message->msg[len] & 0xc0) == 0x80)
+            len -= 1;
+    }
+
+    memcpy(event.text, message->msg, len);
+    event.size = len;
+    trace__push(&event);
+}
+
+static void
+trace__log_flush(log_sink_t* sink)
+{
+    UNUSED(sink);
+}
+
+static void
+trace__push(const trace__event_t* event)
+{
+    mutex_lock(&gTrace.lock);
+
+    if (gTrace.active) {
+        gTrace.events[gTrace.head % gTrace.capacity] = *event;
+        gTrace.head += 1;
+    }
+
+    mutex_unlock(&gTrace.lock);
+}
+
+static void
+trace__write_event(FILE* file, const trace__event_t* event, uint64_t base)
+{
+    /* Events from before trace_start (zones still open then) are clamped to it */
+    double ts = event->time > base ? time_to_us(event->time - base) : 0.0;
+    const char* name = event->file ? event->file + (event->file[0] == '/') : "";
+
+    switch (event->type)
+    {
+        case TRACE__ZONE:
+            fputs("{\"name\":", file);
+            trace__json_string(file, event->name, strlen(event->name));
+            fprintf(file,
+                    ",\"cat\":\"zone\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"file\":",
+                    ts, time_to_us(event->duration), event->thread);
+            trace__json_string(file, name, strlen(name));
+            fprintf(file, ",\"line\":%d}}", event->line);
+            break;
+
+        case TRACE__LOG:
+            fputs("{\"name\":", file);
+            trace__json_string(file, event->text, (size_t)event->size);
+            fprintf(file,
+                    ",\"cat\":\"log\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"level\":\"%s\",\"func\":",
+                    ts, event->thread, log_level_name(event->level));
+            trace__json_string(file, event->name, strlen(event->name));
+            fputs(",\"file\":", file);
+            trace__json_string(file, name, strlen(name));
+            fprintf(file, ",\"line\":%d}}", event->line);
+            break;
+
+        case TRACE__ALLOC:
+            fprintf(file,
+                    "{\"name\":\"alloc %llu B\",\"cat\":\"memory\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,"
+                    "\"args\":{\"size\":%llu,\"file\":",
+                    (unsigned long long)event->size, ts, event->thread, (unsigned long long)event->size);
+            trace__json_string(file, name, strlen(name));
+            fprintf(file, ",\"line\":%d}}", event->line);
+            break;
+
+        case TRACE__FRAME:
+            fprintf(file,
+                    "{\"name\":\"Frame %llu\",\"cat\":\"frame\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u,"
+                    "\"args\":{\"ms\":%.3f}},\n",
+                    (unsigned long long)event->index, ts, time_to_us(event->duration), TRACE__FRAMES_TID,
+                    time_to_ms(event->duration));
+            fprintf(file,
+                    "{\"name\":\"Memory\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"args\":{\"bytes\":%llu}}",
+                    ts + time_to_us(event->duration), (unsigned long long)event->size);
+            break;
+    }
+}
+
+static void
+trace__json_string(FILE* file, const char* str, size_t len)
+{
+    putc('"', file);
+
+    for (size_t i = 0; i < len; ++i) {
+        unsigned char c = (unsigned char)str[i];
+
+        switch (c) {
+            case '"':  fputs("\\\"", file); break;
+            case '\\': fputs("\\\\", file); break;
+            case '\n': fputs("\\n", file);  break;
+            case '\r': fputs("\\r", file);  break;
+            case '\t': fputs("\\t", file);  break;
+
+            default:
+                if (c < 0x20)
+                    fprintf(file, "\\u%04x", c);
+                else
+                    putc(c, file);
+        }
+    }
+
+    putc('"', file);
+}
@@ -20,10 +20,20 @@ vector__resize(void* v, size_t n, size_t type_size)
 
         if (!v_new)
             return NULL;
-
-        v_new[1] = v_old[1];
     }
 
     v_new[0] = n;
     return (void*)(v_new + 2);
 }
+
+void*
+vector__grow(void* v, size_t n, size_t type_size)
+{
+    if (!v)
+        return vector__resize(NULL, n, type_size);
+
+    size_t needed = vector_size(v) + n;
+    size_t capacity = vector_capacity(v) << 1;
+
+    return vector__resize(v, capacity > needed ? capacity : needed, type_size);
+}
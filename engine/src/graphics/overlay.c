@@ -0,0 +1,109 @@
+#include "engine/graphics/overlay.h"
+#include "engine/core/frame.h"
+#include "engine/core/timer.h"
+
+#include <stdio.h>
+
+#define OVERLAY__GRAPH_MIN_MS (1000.0f / 30.0f) /* The graph's range never goes below two 60 Hz frames */
+#define OVERLAY__MAX_NODES    32                 /* Profiler zones listed per hitch */
+
+static void overlay__stats_row(struct nk_context* ctx, const char* name, const frame_stats_t* stats);
+
+void
+overlay_frame_stats(struct nk_context* ctx, struct nk_rect bounds)
+{
+    const nk_flags flags = NK_WINDOW_BORDER | NK_WINDOW_MOVABLE | NK_WINDOW_SCALABLE
+                         | NK_WINDOW_MINIMIZABLE | NK_WINDOW_TITLE;
+
+    if (!nk_begin(ctx, "Frame time", bounds, flags)) {
+        nk_end(ctx);
+        return;
+    }
+
+    char text[128];
+    frame_stats_t stats;
+    frame_stats(&stats);
+
+    snprintf(text, sizeof(text), "Frame %llu: %.2f ms (%.0f fps avg)",
+             (unsigned long long)frame_index(), frame_last_ms(), stats.avg > 0.0 ? 1000.0 / stats.avg : 0.0);
+
+    nk_layout_row_dynamic(ctx, 18, 1);
+    nk_label(ctx, text, NK_TEXT_LEFT);
+
+    /* --- Graph ---------- */
+    float history[FRAME_HISTORY];
+    size_t count = frame_history(history, FRAME_HISTORY);
+    float top = (float)stats.max > OVERLAY__GRAPH_MIN_MS ? (float)stats.max : OVERLAY__GRAPH_MIN_MS;
+
+    nk_layout_row_dynamic(ctx, 80, 1);
+
+    if (count && nk_chart_begin(ctx, NK_CHART_LINES, (int)count, 0.0f, top)) {
+        for (size_t i = 0; i < count; ++i)
+            nk_chart_push(ctx, history[i]);
+
+        nk_chart_end(ctx);
+    }
+
+    /* --- Statistics ---------- */
+    nk_layout_row_dynamic(ctx, 16, 7);
+
+    const char* header[] = {"ms", "min", "avg", "max", "p50", "p95", "p99"};
+
+    for (size_t i = 0; i < 7; ++i)
+        nk_label(ctx, header[i], i ? NK_TEXT_RIGHT : NK_TEXT_LEFT);
+
+    overlay__stats_row(ctx, "frame", &stats);
+
+    for (size_t i = 0; i < frame_phase_count(); ++i) {
+        frame_phase_stats(i, &stats);
+        overlay__stats_row(ctx, frame_phase_name(i), &stats);
+    }
+
+    /* --- Hitches ---------- */
+    snprintf(text, sizeof(text), "Hitches (%zu)", frame_hitch_count());
+
+    if (nk_tree_push(ctx, NK_TREE_TAB, text, NK_MINIMIZED)) {
+        for (size_t i = 0; i < frame_hitch_count(); ++i) {
+            const frame_hitch_t* hitch = frame_hitch(i);
+
+            snprintf(text, sizeof(text), "Frame %llu: %.2f ms", (unsigned long long)hitch->index, hitch->ms);
+
+            if (!nk_tree_push_id(ctx, NK_TREE_NODE, text, NK_MINIMIZED, (int)i))
+                continue;
+
+            nk_layout_row_dynamic(ctx, 16, 1);
+
+            if (!hitch->profile)
+                nk_label(ctx, "No profile", NK_TEXT_LEFT);
+
+            for (size_t j = 0; hitch->profile && j < hitch->profile->count && j < OVERLAY__MAX_NODES; ++j) {
+                const profile_node_t* node = &hitch->profile->nodes[j];
+
+                snprintf(text, sizeof(text), "%*s%s  %.2f ms (%u)",
+                         (int)node->depth * 2, "", node->zone->name, time_to_ms(node->inclusive), node->calls);
+                nk_label(ctx, text, NK_TEXT_LEFT);
+            }
+
+            nk_tree_pop(ctx);
+        }
+
+        nk_tree_pop(ctx);
+    }
+
+    nk_end(ctx);
+}
+
+
+static void
+overlay__stats_row(struct nk_context* ctx, const char* name, const frame_stats_t* stats)
+{
+    const double values[] = {stats->min, stats->avg, stats->max, stats->p50, stats->p95, stats->p99};
+    char text[32];
+
+    nk_label(ctx, name, NK_TEXT_LEFT);
+
+    for (size_t i = 0; i < 6; ++i) {
+        snprintf(text, sizeof(text), "%.2f", values[i]);
+        nk_label(ctx, text, NK_TEXT_RIGHT);
+    }
+}
@@ -1,35 +1,50 @@
 #include "engine/graphics/window.h"
 #include "engine/core/log.h"
 #include "engine/core/memory.h"
+#include "engine/core/frame.h"
+#include "engine/core/profile.h"
+#include "engine/core/timer.h"
+#include "engine/core/trace.h"
 #include "engine/core/base.h"
 
 #include "GLFW/glfw3.h"
 
 #include <stdbool.h>
 
+#ifndef WINDOW_OSMESA
+    #define WINDOW_OSMESA 0
+#endif
+
+#define WINDOW__FRAME_NS (TIME_NS_PER_SEC / 60)
+
+static GLFWwindow* window__create_native(const window_props_t* props);
+
 window_t*
 window_create(window_props_t* props)
 {
-    /* --- Init glfw ---------- */
-    log_assert(glfwInit() == GLFW_TRUE, "Failed to initialize GLFW");
+    window_t* window = calloc(1, sizeof(*window));
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    if (!window) {
+        loge("Failed to create window");
+        return NULL;
+    }
 
-#if PLATFORM_APPLE
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#endif
+    window->props       = *props;
+    window->frame_ns    = WINDOW__FRAME_NS;
+    window->is_headless = (props->flags & WINDOW_HEADLESS) != 0;
 
-    GLFWwindow* native_window = glfwCreateWindow(props->w, props->h, props->title, NULL, NULL);
-    log_assert(native_window, "Failed to create native window");
+    /* Starts where the real clock is, so times from either look alike */
+    if (window->is_headless) {
+        window->clock = time_now();
+        return window;
+    }
 
-    /* --- Init window ---------- */
-    window_t* window = calloc(1, sizeof(*window));
-    log_assert(window, "Failed to create window");
+    window->window = window__create_native(props);
 
-    window->window = native_window;
-    window->props = *props;
+    if (!window->window) {
+        free(window);
+        return NULL;
+    }
 
     if (window->props.x == WINDOWPOS_CENTERED
         && window->props.y == WINDOWPOS_CENTERED)
@@ -37,12 +52,12 @@ window_create(window_props_t* props)
     else
         glfwSetWindowPos(window->window, window->props.x, window->props.y);
 
-    window->is_maximized = (props->flags >> WINDOW_FULLSCREEN) & 1U;
+    window->is_maximized = (props->flags & WINDOW_FULLSCREEN) != 0;
     window->is_minimized = 0;
-    window->is_resizable = !((props->flags >> WINDOW_NOT_RESIZABLE) & 1U);
-    window->is_movable   = !((props->flags >> WINDOW_NOT_MOVABLE) & 1U);
+    window->is_resizable = !(props->flags & WINDOW_NOT_RESIZABLE);
+    window->is_movable   = !(props->flags & WINDOW_NOT_MOVABLE);
     window->is_focused   = 1;
-    window->is_vsync     = (props->flags >> WINDOW_VSYNC) & 1U;
+    window->is_vsync     = (props->flags & WINDOW_VSYNC) != 0;
 
     if (window->is_vsync)
         window_set_vsync(window, 1);
@@ -61,21 +76,33 @@ window_destroy(window_t* window)
     if (!window)
         return;
 
-    glfwDestroyWindow(window->window);
+    if (window->window) {
+        glfwDestroyWindow(window->window);
+        glfwTerminate(); /** TODO: For now */
+    }
 
     free(window);
-    window = NULL;
-
-    glfwTerminate(); /** TODO: For now */
 }
 
 void
-window_flip(const window_t* window)
+window_flip(window_t* window)
 {
+    PROFILE_FUNCTION();
+
     if (!window)
         return;
 
-    glfwSwapBuffers(window->window);
+    frame_phase("present");
+
+    if (window->is_headless)
+        window->clock += window->frame_ns;
+    else
+        glfwSwapBuffers(window->window);
+
+    /* In this order, so the trace and the frame stats see the profile of the frame that just ended */
+    profile_frame();
+    trace_frame();
+    frame_end();
 }
 
 void
@@ -102,13 +129,52 @@ window_is_open(const window_t* window)
     if (!window)
         return 0;
 
-    return !glfwWindowShouldClose(window->window);
+    return window->is_headless || !glfwWindowShouldClose(window->window);
+}
+
+bool
+window_is_headless(const window_t* window)
+{
+    return window && window->is_headless;
+}
+
+uint64_t
+window_time(const window_t* window)
+{
+    return window_is_headless(window) ? window->clock : time_now();
+}
+
+void
+window_set_current(const window_t* window, bool current)
+{
+    if (!window || !window->window)
+        return;
+
+    glfwMakeContextCurrent(current ? window->window : NULL);
+}
+
+void
+window_wake(const window_t* window)
+{
+    if (!window || !window->window)
+        return;
+
+    glfwPostEmptyEvent();
+}
+
+void
+window_set_frame_time(window_t* window, uint64_t ns)
+{
+    if (!window)
+        return;
+
+    window->frame_ns = ns ? ns : WINDOW__FRAME_NS;
 }
 
 void
 window_maximize(window_t* window)
 {
-    if (window->is_maximized)
+    if (!window || !window->window || window->is_maximized)
         return;
 
     GLFWmonitor* monitor = glfwGetPrimaryMonitor();
@@ -133,7 +199,7 @@ window_maximize(window_t* window)
 void
 window_minimize(window_t* window)
 {
-    if (!window)
+    if (!window || !window->window)
         return;
 
     window->props.w = 0;
@@ -144,7 +210,7 @@ window_minimize(window_t* window)
 void
 window_restore(window_t* window)
 {
-    if (!window)
+    if (!window || !window->window)
         return;
 
     glfwSetWindowMonitor(window->window,
@@ -155,3 +221,48 @@ window_restore(window_t* window)
                          window->props.h_original,
                          GLFW_DONT_CARE);
 }
+
+
+static GLFWwindow*
+window__create_native(const window_props_t* props)
+{
+#if !WINDOW_OSMESA
+    if (props->flags & WINDOW_OFFSCREEN) {
+        loge("Offscreen windows need the engine built with ENGINE_OSMESA");
+        return NULL;
+    }
+#elif defined(GLFW_PLATFORM_NULL)
+    /* Since GLFW 3.4 an OSMesa context needs no display at all, before it that still takes a hidden X11 window */
+    glfwInitHint(GLFW_PLATFORM, (props->flags & WINDOW_OFFSCREEN) ? GLFW_PLATFORM_NULL : GLFW_ANY_PLATFORM);
+#endif
+
+    if (glfwInit() != GLFW_TRUE) {
+        loge("Failed to initialize GLFW");
+        return NULL;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+#if PLATFORM_APPLE
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+#if WINDOW_OSMESA
+    if (props->flags & WINDOW_OFFSCREEN) {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+    }
+#endif
+
+    GLFWwindow* native_window = glfwCreateWindow(props->w, props->h, props->title, NULL, NULL);
+
+    if (!native_window) {
+        loge("Failed to create native window");
+        glfwTerminate();
+        return NULL;
+    }
+
+    return native_window;
+}
@@ -1,29 +1,193 @@
+#include <stdlib.h>
+#include <string.h>
+
 #include "engine/graphics/window.h"
 #include "engine/core/all.h"
 
+static struct
+{
+    int greet;
+    int profile;
+    int trace;
+    int stats;
+} gActions;
+
+/* What render is asked to do, the frame stats and the profile belong to the thread that flips */
+typedef struct sandbox_packet_t
+{
+    bool print_profile;
+    bool log_stats;
+} sandbox_packet_t;
+
+/* Gathered by the updates until the next submit */
+static sandbox_packet_t gRequests;
+
+/* Set from the command line, see sandbox_usage */
+static struct
+{
+    unsigned    flags;
+    const char* record;
+    const char* replay;
+    uint64_t    frames;     /* 0 runs until the window is closed */
+    bool        render_thread;
+} gOptions;
+
+static void
+sandbox_usage(void)
+{
+    fprintf(stderr,
+            "usage: sandbox [options]\n"
+            "  --headless       no window or GL, a virtual clock\n"
+            "  --offscreen      a hidden window with a software GL context\n"
+            "  --record <path>  record the input\n"
+            "  --replay <path>  replay recorded input, quits at its end\n"
+            "  --frames <n>     quit after n frames\n"
+            "  --render-thread  render on a thread of its own\n");
+}
+
+static bool
+sandbox_parse(int argc, char** argv)
+{
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--headless") == 0) {
+            gOptions.flags |= WINDOW_HEADLESS;
+        } else if (strcmp(arg, "--offscreen") == 0) {
+            gOptions.flags |= WINDOW_OFFSCREEN;
+        } else if (strcmp(arg, "--record") == 0 && value) {
+            gOptions.record = argv[++i];
+        } else if (strcmp(arg, "--replay") == 0 && value) {
+            gOptions.replay = argv[++i];
+        } else if (strcmp(arg, "--frames") == 0 && value) {
+            gOptions.frames = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(arg, "--render-thread") == 0) {
+            gOptions.render_thread = true;
+        } else {
+            sandbox_usage();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void
+sandbox_bind(input_t* input)
+{
+    gActions.greet   = input_action(input, "greet");
+    gActions.profile = input_action(input, "print_profile");
+    gActions.trace   = input_action(input, "export_trace");
+    gActions.stats   = input_action(input, "log_frame_stats");
+
+    input_action_bind(input, gActions.greet,   (input_binding_t){INPUT_BIND_KEY, 0, KEY_A, 1.0f});
+    input_action_bind(input, gActions.profile, (input_binding_t){INPUT_BIND_KEY, 0, KEY_P, 1.0f});
+    input_action_bind(input, gActions.trace,   (input_binding_t){INPUT_BIND_KEY, 0, KEY_T, 1.0f});
+    input_action_bind(input, gActions.stats,   (input_binding_t){INPUT_BIND_KEY, 0, KEY_F, 1.0f});
+}
+
+static void
+sandbox_update(app_t* app, double dt)
+{
+    UNUSED(dt);
+
+    if (gOptions.replay && !input_is_replaying(app->input))
+        app_quit(app);
+
+    if (input_action_pressed(app->input, gActions.greet))
+        logi("'A' key was pressed this frame");
+
+    if (input_action_pressed(app->input, gActions.profile))
+        gRequests.print_profile = true;
+
+    if (input_action_pressed(app->input, gActions.trace))
+        trace_export("trace.json");
+
+    if (input_action_pressed(app->input, gActions.stats))
+        gRequests.log_stats = true;
+}
+
+static void
+sandbox_submit(app_t* app, void* packet, double alpha)
+{
+    UNUSED(app);
+    UNUSED(alpha);
+
+    *(sandbox_packet_t*)packet = gRequests;
+    gRequests = (sandbox_packet_t){0};
+}
+
+/* On the render thread with --render-thread, so it reads the packet and not the input */
+static void
+sandbox_render(app_t* app, double alpha)
+{
+    UNUSED(alpha);
+
+    const sandbox_packet_t* packet = app->packet;
+
+    if (packet->print_profile)
+        profile_print(profile_last(), stdout);
+
+    if (packet->log_stats) {
+        frame_stats_t stats;
+        frame_stats(&stats);
+        logi("Frame time: min %.2f avg %.2f max %.2f p50 %.2f p95 %.2f p99 %.2f ms",
+             stats.min, stats.avg, stats.max, stats.p50, stats.p95, stats.p99);
+    }
+
+    if (gOptions.frames && frame_index() + 1 >= gOptions.frames)
+        app_quit(app);
+}
 
 int
-main(void)
+main(int argc, char** argv)
 {
-    window_props_t win_props = {
-        "Sandbox",
-        WINDOWPOS_CENTERED, WINDOWPOS_CENTERED, 640, 480,
-        WINDOWPOS_CENTERED, WINDOWPOS_CENTERED, 640, 480,
-        0
+    if (!sandbox_parse(argc, argv))
+        return 1;
+
+    log_sink_t* recent = logsink_ring_create(64);
+    log_sink_add(recent);
+    crash_init("crash.txt", recent);
+    log_async_start();
+
+    trace_props_t trace_props = {0, 0, 50.0, NULL};
+    trace_start(&trace_props);
+
+    app_props_t app_props = {
+        {
+            "Sandbox",
+            WINDOWPOS_CENTERED, WINDOWPOS_CENTERED, 640, 480,
+            WINDOWPOS_CENTERED, WINDOWPOS_CENTERED, 640, 480,
+            gOptions.flags
+        },
+        60.0, 60.0, 0,
+        sandbox_update,
+        sandbox_render,
+        NULL,
+        false,
+        gOptions.render_thread,
+        sizeof(sandbox_packet_t),
+        sandbox_submit
     };
 
-    window_t* window = window_create(&win_props);
-    input_t* input = input_create(window);
+    app_t* app = app_create(&app_props);
+
+    if (app) {
+        sandbox_bind(app->input);
 
-    while (window_is_open(window)) {
-        input_poll_events(input);
+        if (gOptions.record)
+            input_record_start(app->input, gOptions.record);
 
-        if (input_key_pressed(input, KEY_A))
-            logi("'A' key was pressed this frame");
+        if (gOptions.replay)
+            input_replay_start(app->input, gOptions.replay);
 
-        window_flip(window);
+        app_run(app);
     }
 
-    input_destroy(input);
-    window_destroy(window);
+    app_destroy(app);
+    trace_stop();
+    log_async_stop();
+    crash_shutdown();
+    logsink_destroy(recent);
 }
@@ -0,0 +1,43 @@
+/**
+ * bench.h
+ *
+ * @brief What the benchmarks share, a seeded generator and result printing
+ *
+ * The benchmarks build against the engine at its configured optimisation
+ * level, configure with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "engine/core/timer.h"
+
+#include <stdio.h>
+
+/** xorshift64, the same seed gives every run the same input */
+static inline uint64_t
+bench_rand(uint64_t* state)
+{
+    uint64_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+/** Prints the total time and the time per operation */
+static inline void
+bench_report(const char* name, uint64_t ns, size_t ops)
+{
+    printf("%-32s %10.3f ms %10.2f ns/op\n", name, time_to_ms(ns), ops ? (double)ns / (double)ops : 0.0);
+}
+
+/** Prints the total time and the throughput */
+static inline void
+bench_report_bytes(const char* name, uint64_t ns, size_t bytes)
+{
+    printf("%-32s %10.3f ms %10.1f MB/s\n", name, time_to_ms(ns), ns ? (double)bytes / 1e6 / time_to_sec(ns) : 0.0);
+}
+
+#endif /* BENCH_H */
@@ -0,0 +1,168 @@
+/*
+ * Pushes n random priorities into a heap, a pqueue_t and a vector kept sorted
+ * by insertion, then pops them all back in order:
+ *
+ *     bench_heap [count ...]
+ */
+#include "bench.h"
+
+#include "engine/core/heap.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* After the system headers, vectors are freed through the engine's allocator */
+#include "engine/core/memory.h"
+
+static int
+cmp_double(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double
+rand_priority(uint64_t* seed)
+{
+    return (double)(bench_rand(seed) >> 11) / (double)(1ULL << 53);
+}
+
+static bool
+bench_heap(const double* priorities, size_t n)
+{
+    double* heap;
+    double last = 0.0;
+    bool ok = true;
+
+    heap_init(heap);
+
+    uint64_t timer = timer_start();
+
+    for (size_t i = 0; i < n; ++i)
+        heap_push(heap, priorities[i], cmp_double);
+
+    bench_report("  heap_push", timer_split(&timer), n);
+
+    for (size_t i = 0; i < n; ++i) {
+        double top = heap_pop(heap, cmp_double);
+        ok = ok && top >= last;
+        last = top;
+    }
+
+    bench_report("  heap_pop", timer_split(&timer), n);
+
+    heap_free(heap);
+    return ok;
+}
+
+static bool
+bench_pqueue(const double* priorities, size_t n)
+{
+    pqueue_t* queue = pqueue_create(n);
+    double last = 0.0;
+    bool ok = queue != NULL;
+
+    if (!ok)
+        return false;
+
+    uint64_t timer = timer_start();
+
+    for (size_t i = 0; i < n; ++i)
+        pqueue_push(queue, (uint32_t)i, priorities[i]);
+
+    bench_report("  pqueue_push", timer_split(&timer), n);
+
+    /* Halves every priority, the same ids in a different order */
+    for (size_t i = 0; i < n; ++i)
+        pqueue_decrease(queue, (uint32_t)(n - 1 - i), priorities[n - 1 - i] * 0.5);
+
+    bench_report("  pqueue_decrease", timer_split(&timer), n);
+
+    for (size_t i = 0; i < n; ++i) {
+        double priority;
+        pqueue_pop(queue, &priority);
+        ok = ok && priority >= last;
+        last = priority;
+    }
+
+    bench_report("  pqueue_pop", timer_split(&timer), n);
+
+    pqueue_destroy(queue);
+    return ok;
+}
+
+/* The alternative to a heap, kept in descending order so popping takes the back */
+static bool
+bench_sorted(const double* priorities, size_t n)
+{
+    double* sorted;
+    double last = 0.0;
+    bool ok = true;
+
+    vector_init(sorted);
+
+    uint64_t timer = timer_start();
+
+    for (size_t i = 0; i < n; ++i) {
+        size_t lo = 0;
+        size_t hi = vector_size(sorted);
+
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+
+            if (sorted[mid] > priorities[i])
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        vector_insert(sorted, lo, priorities[i]);
+    }
+
+    bench_report("  sorted vector insert", timer_split(&timer), n);
+
+    for (size_t i = 0; i < n; ++i) {
+        double top = vector_pop(sorted);
+        ok = ok && top >= last;
+        last = top;
+    }
+
+    bench_report("  sorted vector pop", timer_split(&timer), n);
+
+    vector_free(sorted);
+    return ok;
+}
+
+int
+main(int argc, char** argv)
+{
+    static const size_t counts[] = { 1000, 10000, 100000 };
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    bool ok = true;
+
+    time_calibrate();
+
+    for (int i = 0; i < (argc > 1 ? argc - 1 : 3); ++i) {
+        size_t n = argc > 1 ? strtoull(argv[i + 1], NULL, 10) : counts[i];
+        double* priorities = malloc(n * sizeof(*priorities));
+
+        if (!priorities)
+            return EXIT_FAILURE;
+
+        for (size_t j = 0; j < n; ++j)
+            priorities[j] = rand_priority(&seed);
+
+        printf("%zu priorities\n", n);
+        ok = bench_heap(priorities, n) && ok;
+        ok = bench_pqueue(priorities, n) && ok;
+        ok = bench_sorted(priorities, n) && ok;
+
+        free(priorities);
+    }
+
+    if (!ok)
+        printf("A queue popped out of order\n");
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
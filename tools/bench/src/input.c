@@ -0,0 +1,111 @@
+/*
+ * Measures what a frame of input costs with no window attached, idle and with
+ * a few keys pressed and released every frame. The events are pushed straight
+ * into the input's stream, where the GLFW callbacks would put them. A clear
+ * of a bool per key, as input state used to be kept, is timed next to it:
+ *
+ *     bench_input [frames]
+ */
+#include "bench.h"
+
+#include "engine/core/input.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ACTIONS 8
+
+static void
+push_key(input_t* input, int key, uint8_t action)
+{
+    input->stream.events[input->stream.head++ & (INPUT_EVENT_CAPACITY - 1)] =
+        (input_event_t){ time_now(), INPUT_EVENT_KEY, (uint16_t)key, action, 0, 0.0f, 0.0f };
+}
+
+static bool gPressed[KEY_LAST];
+static bool gReleased[KEY_LAST];
+
+static void
+clear_all(void)
+{
+    for (int key = 0; key < KEY_LAST; ++key) {
+        gPressed[key]  = false;
+        gReleased[key] = false;
+    }
+}
+
+/* Called through a pointer so the loop isn't folded across frames */
+static void (*volatile gClearAll)(void) = clear_all;
+
+/* Presses that many keys on even frames and releases them on odd ones */
+static uint64_t
+run_frames(input_t* input, size_t frames, int keys)
+{
+    size_t any = 0;
+    uint64_t timer = timer_start();
+
+    for (size_t frame = 0; frame < frames; ++frame) {
+        for (int i = 0; i < keys; ++i)
+            push_key(input, KEY_A + i, frame & 1 ? ACTION_RELEASE : ACTION_PRESS);
+
+        input_poll_events(input);
+        any += input_key_any_pressed(input);
+    }
+
+    uint64_t ns = timer_read(timer);
+
+    if (keys && any != (frames + 1) / 2)
+        printf("Expected a press every other frame, got %zu in %zu frames\n", any, frames);
+
+    return ns;
+}
+
+int
+main(int argc, char** argv)
+{
+    size_t frames = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000000;
+
+    time_calibrate();
+
+    input_t* input = input_create(NULL);
+
+    if (!input)
+        return EXIT_FAILURE;
+
+    uint64_t timer = timer_start();
+
+    for (size_t frame = 0; frame < frames; ++frame)
+        gClearAll();
+
+    bench_report("clear a bool per key", timer_read(timer), frames);
+
+    /* input_consume is the refresh on its own, without a poll around it */
+    input_set_latched(input, true);
+    timer_split(&timer);
+
+    for (size_t frame = 0; frame < frames; ++frame)
+        input_consume(input);
+
+    bench_report("input_consume, idle", timer_read(timer), frames);
+    input_set_latched(input, false);
+
+    static const int counts[] = { 0, 1, 8, 64 };
+
+    for (size_t i = 0; i < sizeof(counts) / sizeof(*counts); ++i) {
+        char name[32];
+        snprintf(name, sizeof(name), "poll, %d keys a frame", counts[i]);
+        bench_report(name, run_frames(input, frames, counts[i]), frames);
+    }
+
+    /* Refresh also clears every action's edges */
+    for (int i = 0; i < ACTIONS; ++i) {
+        char name[16];
+        snprintf(name, sizeof(name), "action%d", i);
+        input_action_bind(input, input_action(input, name), (input_binding_t){ INPUT_BIND_KEY, 0, (uint16_t)(KEY_A + i), 1.0f });
+    }
+
+    bench_report("poll, 8 keys and 8 actions", run_frames(input, frames, 8), frames);
+
+    input_destroy(input);
+    return EXIT_SUCCESS;
+}
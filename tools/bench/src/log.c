@@ -0,0 +1,154 @@
+/*
+ * Measures how long a logi call blocks its thread, logging synchronously and
+ * through the async writer, from one thread and from several at once. The
+ * console is swapped for a sink that only counts, so terminal I/O stays out
+ * of the numbers, then for a file sink writing to /dev/null, which pays for a
+ * write(2) per flush:
+ *
+ *     bench_log [calls]
+ */
+#include "bench.h"
+
+#include "engine/core/log.h"
+#include "engine/core/logsink.h"
+#include "engine/core/sort.h"
+#include "engine/core/thread.h"
+
+#include <stdlib.h>
+
+#define THREADS 4
+#define BURST   512     /* Calls between flushes, fits the async ring so nothing is dropped */
+
+typedef struct worker_t
+{
+    thread_t  thread;
+    uint64_t* latencies;
+    size_t    calls;
+} worker_t;
+
+static size_t gWritten = 0;
+
+static void
+count_write(log_sink_t* sink, const log_message_t* message)
+{
+    (void)sink;
+    (void)message;
+    gWritten += 1;
+}
+
+static void
+count_flush(log_sink_t* sink)
+{
+    (void)sink;
+}
+
+static log_sink_t gCounter = { count_write, count_flush, NULL, 0xFF };
+
+/* Times every call on its own, flushing between bursts when flush is set */
+static void
+log_calls(uint64_t* latencies, size_t calls, bool flush)
+{
+    for (size_t i = 0; i < calls; ++i) {
+        uint64_t start = time_now();
+        logi("frame %zu took %.3f ms in %s", i, (double)(i % 100) * 0.01, "render");
+        latencies[i] = time_now() - start;
+
+        if (flush && i % BURST == BURST - 1)
+            log_flush();
+    }
+}
+
+static void*
+worker_main(void* arg)
+{
+    worker_t* worker = arg;
+    log_calls(worker->latencies, worker->calls, true);
+    return NULL;
+}
+
+static void
+report(const char* name, uint64_t* latencies, size_t n)
+{
+    uint64_t total = 0;
+
+    for (size_t i = 0; i < n; ++i)
+        total += latencies[i];
+
+    sort_radix_u64(latencies, NULL, n);
+    printf("%-24s mean %8.1f ns  p50 %6llu ns  p99 %7llu ns  p99.9 %8llu ns  max %9llu ns\n", name,
+        (double)total / (double)n, (unsigned long long)latencies[n / 2], (unsigned long long)latencies[n * 99 / 100],
+        (unsigned long long)latencies[n * 999 / 1000], (unsigned long long)latencies[n - 1]);
+}
+
+int
+main(int argc, char** argv)
+{
+    size_t calls = argc > 1 ? strtoull(argv[1], NULL, 10) : 200000;
+    uint64_t* latencies = malloc(calls * THREADS * sizeof(*latencies));
+    worker_t workers[THREADS];
+
+    if (!latencies || !calls)
+        return EXIT_FAILURE;
+
+#if LOG_LEVEL_MIN > 2
+    printf("logi is compiled out at this ENGINE_LOG_LEVEL_MIN, the numbers only show the empty call\n");
+#endif
+
+    time_calibrate();
+
+    log_sink_remove(log_console());
+    log_sink_add(&gCounter);
+
+    log_calls(latencies, calls, false);
+    report("sync", latencies, calls);
+
+    log_async_start();
+
+    log_calls(latencies, calls, true);
+    log_flush();
+    report("async", latencies, calls);
+
+    /* No flushing, the ring fills up and the rest is dropped */
+    unsigned dropped = log_dropped();
+    log_calls(latencies, calls, false);
+    log_flush();
+    report("async unflushed", latencies, calls);
+    printf("%24s %u of %zu dropped\n", "", log_dropped() - dropped, calls);
+
+    for (int i = 0; i < THREADS; ++i) {
+        workers[i] = (worker_t){ .latencies = latencies + i * calls, .calls = calls };
+
+        if (!thread_create(&workers[i].thread, worker_main, &workers[i]))
+            return EXIT_FAILURE;
+    }
+
+    for (int i = 0; i < THREADS; ++i)
+        thread_join(workers[i].thread);
+
+    log_flush();
+    report("async 4 threads", latencies, calls * THREADS);
+
+    log_async_stop();
+    log_sink_remove(&gCounter);
+
+    logsink_file_props_t props = { .path = "/dev/null", .format = LOGSINK_TEXT };
+    log_sink_t* file = logsink_file_create(&props);
+
+    if (file && log_sink_add(file)) {
+        log_calls(latencies, calls, false);
+        report("file sync", latencies, calls);
+
+        log_async_start();
+        log_calls(latencies, calls, true);
+        log_flush();
+        report("file async", latencies, calls);
+        log_async_stop();
+    }
+
+    logsink_destroy(file);
+    log_sink_add(log_console());
+
+    printf("%zu messages reached the sink\n", gWritten);
+    free(latencies);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,208 @@
+/*
+ * Sorts 1M and 10M random keys with a payload using qsort and the radix
+ * sorts, then builds a flatmap_t of them and looks them up with and without
+ * the frozen layout:
+ *
+ *     bench_sort [count ...]
+ */
+#include "bench.h"
+
+#include "engine/core/flatmap.h"
+#include "engine/core/sort.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct pair32_t
+{
+    uint32_t key;
+    uint32_t val;
+} pair32_t;
+
+typedef struct pair64_t
+{
+    uint64_t key;
+    uint32_t val;
+} pair64_t;
+
+static int
+cmp_pair32(const void* a, const void* b)
+{
+    uint32_t x = ((const pair32_t*)a)->key;
+    uint32_t y = ((const pair32_t*)b)->key;
+    return (x > y) - (x < y);
+}
+
+static int
+cmp_pair64(const void* a, const void* b)
+{
+    uint64_t x = ((const pair64_t*)a)->key;
+    uint64_t y = ((const pair64_t*)b)->key;
+    return (x > y) - (x < y);
+}
+
+static bool
+sorted_u32(const uint32_t* keys, size_t n)
+{
+    for (size_t i = 1; i < n; ++i)
+        if (keys[i - 1] > keys[i])
+            return false;
+
+    return true;
+}
+
+static bool
+sorted_u64(const uint64_t* keys, size_t n)
+{
+    for (size_t i = 1; i < n; ++i)
+        if (keys[i - 1] > keys[i])
+            return false;
+
+    return true;
+}
+
+static bool
+bench_u32(size_t n, uint64_t* seed)
+{
+    uint32_t* input = malloc(n * sizeof(*input));
+    uint32_t* keys = malloc(n * sizeof(*keys));
+    uint32_t* vals = malloc(n * sizeof(*vals));
+    pair32_t* pairs = malloc(n * sizeof(*pairs));
+    bool ok = input && keys && vals && pairs;
+
+    if (ok) {
+        for (size_t i = 0; i < n; ++i)
+            input[i] = (uint32_t)bench_rand(seed);
+
+        for (size_t i = 0; i < n; ++i)
+            pairs[i] = (pair32_t){ input[i], (uint32_t)i };
+
+        uint64_t timer = timer_start();
+        qsort(pairs, n, sizeof(*pairs), cmp_pair32);
+        bench_report("  qsort u32", timer_read(timer), n);
+
+        for (size_t i = 0; i < n; ++i)
+            vals[i] = (uint32_t)i;
+
+        memcpy(keys, input, n * sizeof(*keys));
+        timer = timer_start();
+        sort_radix_u32(keys, vals, n);
+        bench_report("  sort_radix_u32", timer_read(timer), n);
+        ok = ok && sorted_u32(keys, n);
+
+        for (size_t i = 0; i < n; ++i)
+            vals[i] = (uint32_t)i;
+
+        memcpy(keys, input, n * sizeof(*keys));
+        timer = timer_start();
+        sort_radix_u32_mt(keys, vals, n, 0);
+        bench_report("  sort_radix_u32_mt", timer_read(timer), n);
+        ok = ok && sorted_u32(keys, n);
+    }
+
+    free(input);
+    free(keys);
+    free(vals);
+    free(pairs);
+    return ok;
+}
+
+static bool
+bench_u64(size_t n, uint64_t* seed)
+{
+    uint64_t* input = malloc(n * sizeof(*input));
+    uint64_t* keys = malloc(n * sizeof(*keys));
+    uint32_t* vals = malloc(n * sizeof(*vals));
+    pair64_t* pairs = malloc(n * sizeof(*pairs));
+    bool ok = input && keys && vals && pairs;
+
+    if (ok) {
+        for (size_t i = 0; i < n; ++i)
+            input[i] = bench_rand(seed);
+
+        for (size_t i = 0; i < n; ++i)
+            pairs[i] = (pair64_t){ input[i], (uint32_t)i };
+
+        uint64_t timer = timer_start();
+        qsort(pairs, n, sizeof(*pairs), cmp_pair64);
+        bench_report("  qsort u64", timer_read(timer), n);
+
+        for (size_t i = 0; i < n; ++i)
+            vals[i] = (uint32_t)i;
+
+        memcpy(keys, input, n * sizeof(*keys));
+        timer = timer_start();
+        sort_radix_u64(keys, vals, n);
+        bench_report("  sort_radix_u64", timer_read(timer), n);
+        ok = ok && sorted_u64(keys, n);
+
+        for (size_t i = 0; i < n; ++i)
+            vals[i] = (uint32_t)i;
+
+        memcpy(keys, input, n * sizeof(*keys));
+        timer = timer_start();
+        sort_radix_u64_mt(keys, vals, n, 0);
+        bench_report("  sort_radix_u64_mt", timer_read(timer), n);
+        ok = ok && sorted_u64(keys, n);
+
+        /* The keys are still random in input, reuse them for the map */
+        for (size_t i = 0; i < n; ++i)
+            vals[i] = (uint32_t)i;
+
+        flatmap_t* map = flatmap_create(sizeof(uint32_t), n);
+        ok = ok && map;
+
+        if (ok) {
+            timer = timer_start();
+            ok = flatmap_build(map, input, vals, n);
+            bench_report("  flatmap_build", timer_split(&timer), n);
+
+            size_t found = 0;
+
+            for (size_t i = 0; i < n; ++i)
+                found += flatmap_contains(map, input[i]);
+
+            bench_report("  flatmap_contains", timer_split(&timer), n);
+
+            flatmap_freeze(map);
+            bench_report("  flatmap_freeze", timer_split(&timer), n);
+
+            for (size_t i = 0; i < n; ++i)
+                found += flatmap_contains(map, input[i]);
+
+            bench_report("  flatmap_contains frozen", timer_split(&timer), n);
+            ok = ok && found == 2 * n;
+        }
+
+        flatmap_destroy(map);
+    }
+
+    free(input);
+    free(keys);
+    free(vals);
+    free(pairs);
+    return ok;
+}
+
+int
+main(int argc, char** argv)
+{
+    static const size_t counts[] = { 1000000, 10000000 };
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    bool ok = true;
+
+    time_calibrate();
+
+    for (int i = 0; i < (argc > 1 ? argc - 1 : 2); ++i) {
+        size_t n = argc > 1 ? strtoull(argv[i + 1], NULL, 10) : counts[i];
+
+        printf("%zu keys\n", n);
+        ok = bench_u32(n, &seed) && ok;
+        ok = bench_u64(n, &seed) && ok;
+    }
+
+    if (!ok)
+        printf("A sort or lookup gave a wrong result\n");
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
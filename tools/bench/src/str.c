@@ -0,0 +1,147 @@
+/*
+ * Runs the str_* primitives from cstring.h over a 16 MB text buffer next to
+ * the libc or plain C loop each of them replaces:
+ *
+ *     bench_str [megabytes]
+ */
+#include "bench.h"
+
+#include "engine/core/cstring.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REPEATS 8
+
+/* Lowercase words and spaces, so class scans and searches run to the end */
+static void
+fill_text(char* text, size_t len, uint64_t* seed)
+{
+    for (size_t i = 0; i < len; ++i) {
+        uint64_t r = bench_rand(seed) % 32;
+        text[i] = r < 26 ? (char)('a' + r) : ' ';
+    }
+
+    text[len] = '\0';
+}
+
+static void
+scalar_upper(char* str, size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
+        str[i] = (char)toupper((unsigned char)str[i]);
+}
+
+static size_t
+scalar_find_digit(const char* str, size_t len)
+{
+    size_t i = 0;
+
+    while (i < len && !isdigit((unsigned char)str[i]))
+        ++i;
+
+    return i;
+}
+
+static uint64_t
+fnv1a64(const void* data, size_t len)
+{
+    const unsigned char* p = data;
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
+    for (size_t i = 0; i < len; ++i)
+        hash = (hash ^ p[i]) * 0x100000001B3ULL;
+
+    return hash;
+}
+
+int
+main(int argc, char** argv)
+{
+    size_t len = (argc > 1 ? strtoull(argv[1], NULL, 10) : 16) * 1000000;
+    size_t bytes = len * REPEATS;
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    volatile uint64_t sink = 0;
+    bool ok = true;
+
+    time_calibrate();
+
+    char* text = malloc(len + 1);
+    char* copy = malloc(len + 1);
+
+    if (!text || !copy)
+        return EXIT_FAILURE;
+
+    fill_text(text, len, &seed);
+
+    /* A needle that only occurs at the very end */
+    static const char needle[] = "needle9";
+    memcpy(text + len - (sizeof(needle) - 1), needle, sizeof(needle) - 1);
+
+    uint64_t timer = timer_start();
+
+    for (int i = 0; i < REPEATS; ++i) {
+        memcpy(copy, text, len + 1);
+        str_to_upper(copy, len);
+    }
+
+    bench_report_bytes("str_to_upper (with memcpy)", timer_split(&timer), bytes);
+
+    for (int i = 0; i < REPEATS; ++i) {
+        memcpy(copy, text, len + 1);
+        scalar_upper(copy, len);
+    }
+
+    bench_report_bytes("toupper loop (with memcpy)", timer_split(&timer), bytes);
+
+    for (int i = 0; i < REPEATS; ++i)
+        ok = ok && str_find(text, len, needle, sizeof(needle) - 1) == text + len - (sizeof(needle) - 1);
+
+    bench_report_bytes("str_find", timer_split(&timer), bytes);
+
+    for (int i = 0; i < REPEATS; ++i)
+        ok = ok && strstr(text, needle) == text + len - (sizeof(needle) - 1);
+
+    bench_report_bytes("strstr", timer_split(&timer), bytes);
+
+    for (int i = 0; i < REPEATS; ++i)
+        ok = ok && str_find_class(text, len, STR_CLASS_DIGIT) == len - 1;
+
+    bench_report_bytes("str_find_class digit", timer_split(&timer), bytes);
+
+    for (int i = 0; i < REPEATS; ++i)
+        ok = ok && scalar_find_digit(text, len) == len - 1;
+
+    bench_report_bytes("isdigit loop", timer_split(&timer), bytes);
+
+    for (int i = 0; i < REPEATS; ++i)
+        sink += str_hash64(text, len, (uint64_t)i);
+
+    bench_report_bytes("str_hash64", timer_split(&timer), bytes);
+
+    for (int i = 0; i < REPEATS; ++i)
+        sink += fnv1a64(text, len);
+
+    bench_report_bytes("fnv1a64", timer_split(&timer), bytes);
+
+    /* Short keys, as an intern table or hashtable hashes them */
+    size_t keys = len / 16;
+
+    for (size_t i = 0; i < keys; ++i)
+        sink += str_hash64(text + i * 16, 16, 0);
+
+    bench_report("str_hash64 16 byte keys", timer_split(&timer), keys);
+
+    for (size_t i = 0; i < keys; ++i)
+        sink += fnv1a64(text + i * 16, 16);
+
+    bench_report("fnv1a64 16 byte keys", timer_split(&timer), keys);
+
+    if (!ok)
+        printf("A primitive disagreed with its reference\n");
+
+    free(text);
+    free(copy);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,117 @@
+/*
+ * Builds a 10 MB report out of formatted log lines with strbuf_t, string_t and
+ * a preallocated snprintf buffer, cold and then with the capacity warmed up:
+ *
+ *     bench_strbuf [megabytes]
+ */
+#include "bench.h"
+
+#include "engine/core/cstring.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* After the system headers, string_t is freed through the engine's allocator */
+#include "engine/core/memory.h"
+
+#define LINE_FMT "[%10.3f] frame %6zu: %-12s x=%5d y=%8.2f\n"
+
+static const char* gNames[] = { "render", "physics", "audio", "streaming", "input", "network" };
+
+static size_t
+build_strbuf(strbuf_t* buf, size_t target)
+{
+    size_t lines = 0;
+
+    while (strbuf_len(buf) < target) {
+        strbuf_appendf(buf, LINE_FMT, (double)lines * 0.016, lines, gNames[lines % 6], (int)(lines * 7 % 1920), (double)lines * 0.25);
+        strbuf_append_n(buf, "  ok\n", 5);
+        ++lines;
+    }
+
+    return lines;
+}
+
+static size_t
+build_string(string_t* str, size_t target)
+{
+    size_t lines = 0;
+
+    while (string_len(*str) < target) {
+        string_appendf(str, LINE_FMT, (double)lines * 0.016, lines, gNames[lines % 6], (int)(lines * 7 % 1920), (double)lines * 0.25);
+        string_catn(str, "  ok\n", 5);
+        ++lines;
+    }
+
+    return lines;
+}
+
+/* What the builders compete with, a buffer sized up front */
+static size_t
+build_snprintf(char* buf, size_t size, size_t target)
+{
+    size_t lines = 0;
+    size_t len = 0;
+
+    while (len < target) {
+        len += (size_t)snprintf(buf + len, size - len, LINE_FMT, (double)lines * 0.016, lines, gNames[lines % 6], (int)(lines * 7 % 1920), (double)lines * 0.25);
+        memcpy(buf + len, "  ok\n", 6);
+        len += 5;
+        ++lines;
+    }
+
+    return lines;
+}
+
+int
+main(int argc, char** argv)
+{
+    size_t target = (argc > 1 ? strtoull(argv[1], NULL, 10) : 10) * 1000000;
+
+    time_calibrate();
+
+    strbuf_t buf;
+    strbuf_init(&buf);
+
+    uint64_t timer = timer_start();
+    size_t lines = build_strbuf(&buf, target);
+    bench_report_bytes("strbuf_appendf cold", timer_split(&timer), strbuf_len(&buf));
+
+    strbuf_clear(&buf);
+    timer_split(&timer);
+    build_strbuf(&buf, target);
+    bench_report_bytes("strbuf_appendf warm", timer_split(&timer), strbuf_len(&buf));
+
+    string_t str = string_create("");
+    build_string(&str, target);
+    bench_report_bytes("string_appendf cold", timer_split(&timer), string_len(str));
+
+    string_clear(str);
+    timer_split(&timer);
+    build_string(&str, target);
+    bench_report_bytes("string_appendf warm", timer_split(&timer), string_len(str));
+
+    /* Room for the line that crosses the target */
+    size_t size = target + 256;
+    char* raw = malloc(size);
+
+    if (!raw)
+        return EXIT_FAILURE;
+
+    timer_split(&timer);
+    build_snprintf(raw, size, target);
+    bench_report_bytes("snprintf preallocated", timer_split(&timer), strlen(raw));
+
+    bool ok = strbuf_len(&buf) == string_len(str) && !memcmp(strbuf_cstr(&buf), str, string_len(str))
+        && !strcmp(raw, str);
+
+    printf("%zu lines, %zu bytes\n", lines, strbuf_len(&buf));
+
+    if (!ok)
+        printf("The builders produced different text\n");
+
+    free(raw);
+    string_destroy(str);
+    strbuf_free(&buf);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,61 @@
+/*
+ * Schedules 1M timers on a timerwheel_t, cancels half of them and advances
+ * the wheel until the rest have fired:
+ *
+ *     bench_timerwheel [count]
+ */
+#include "bench.h"
+
+#include "engine/core/timerwheel.h"
+
+#include <stdlib.h>
+
+#define TICK_NS     TIME_NS_PER_MS
+#define MAX_DELAY   (1ULL << 20)    /* Ticks, spans four levels of the wheel */
+
+static void
+on_timer(void* arg)
+{
+    *(size_t*)arg += 1;
+}
+
+int
+main(int argc, char** argv)
+{
+    size_t count = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000000;
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    size_t fired = 0;
+
+    time_calibrate();
+
+    timer_id_t* ids = malloc(count * sizeof(*ids));
+    timerwheel_t* wheel = timerwheel_create(TICK_NS, 0);
+
+    if (!ids || !wheel)
+        return EXIT_FAILURE;
+
+    uint64_t timer = timer_start();
+
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t delay = (bench_rand(&seed) % MAX_DELAY + 1) * TICK_NS;
+        ids[i] = timerwheel_schedule(wheel, delay, 0, on_timer, &fired);
+    }
+
+    bench_report("schedule", timer_split(&timer), count);
+
+    for (size_t i = 0; i < count; i += 2)
+        timerwheel_cancel(wheel, ids[i]);
+
+    bench_report("cancel half", timer_split(&timer), count / 2 + count % 2);
+
+    /* Every tick, as a game calling it each frame would, most of them are empty */
+    for (uint64_t tick = 1; tick <= MAX_DELAY; ++tick)
+        timerwheel_advance(wheel, tick * TICK_NS);
+
+    bench_report("advance and fire", timer_split(&timer), fired);
+    printf("%zu of %zu timers fired, %zu left\n", fired, count, wheel->count);
+
+    timerwheel_destroy(wheel);
+    free(ids);
+    return fired == count / 2 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
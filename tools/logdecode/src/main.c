@@ -0,0 +1,330 @@
+/*
+ * Turns a binary log written by log_binary_start back into the text the
+ * engine would have printed:
+ *
+ *     logdecode game.bin > game.log
+ */
+#include "engine/core/log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Far more sites than any program has, ids past it mean a corrupt file */
+#define MAX_SITES (1U << 24)
+
+typedef struct site_t
+{
+    bool          defined;
+    unsigned char level;
+    uint32_t      line;
+    unsigned char nargs;
+    unsigned char args[256];
+    char*         file;
+    char*         func;
+    char*         fmt;
+} site_t;
+
+typedef struct reader_t
+{
+    const unsigned char* data;
+    size_t               size;
+    size_t               pos;
+} reader_t;
+
+static site_t*  sites = NULL;
+static size_t   site_count = 0;
+
+static bool
+read_bytes(reader_t* r, void* dst, size_t len)
+{
+    if (r->size - r->pos < len)
+        return false;
+
+    memcpy(dst, r->data + r->pos, len);
+    r->pos += len;
+    return true;
+}
+
+static char*
+read_string(reader_t* r)
+{
+    uint16_t len;
+
+    if (!read_bytes(r, &len, 2))
+        return NULL;
+
+    char* str = malloc((size_t)len + 1);
+
+    if (!str || !read_bytes(r, str, len)) {
+        free(str);
+        return NULL;
+    }
+
+    str[len] = '\0';
+    return str;
+}
+
+static const char*
+level_name(int level)
+{
+    switch (level)
+    {
+        case LOG_LEVEL_TRACE:  return "TRACE";
+        case LOG_LEVEL_DEBUG:  return "DEBUG";
+        case LOG_LEVEL_INFO:   return "INFO";
+        case LOG_LEVEL_WARN:   return "WARN";
+        case LOG_LEVEL_ERROR:  return "ERROR";
+        case LOG_LEVEL_FATAL:  return "FATAL";
+        case LOG_LEVEL_ASSERT: return "ASSERT";
+    }
+
+    return "";
+}
+
+static bool
+read_site(reader_t* r)
+{
+    uint32_t id;
+    site_t site = {0};
+
+    if (!read_bytes(r, &id, 4) || !read_bytes(r, &site.level, 1) || !read_bytes(r, &site.line, 4) ||
+        !read_bytes(r, &site.nargs, 1) || !read_bytes(r, site.args, site.nargs))
+        return false;
+
+    if (id >= MAX_SITES)
+        return false;
+
+    site.file = read_string(r);
+    site.func = read_string(r);
+    site.fmt  = read_string(r);
+
+    if (!site.file || !site.func || !site.fmt) {
+        free(site.file);
+        free(site.func);
+        free(site.fmt);
+        return false;
+    }
+
+    if (id >= site_count) {
+        /* Both at most 2 * MAX_SITES, the size can't overflow */
+        size_t count = (size_t)id + 1 > site_count * 2 ? (size_t)id + 1 : site_count * 2;
+        site_t* grown = realloc(sites, count * sizeof(*sites));
+
+        if (!grown) {
+            free(site.file);
+            free(site.func);
+            free(site.fmt);
+            return false;
+        }
+
+        memset(grown + site_count, 0, (count - site_count) * sizeof(*sites));
+        sites = grown;
+        site_count = count;
+    }
+
+    /* A restarted log may describe the same site again */
+    if (sites[id].defined) {
+        free(sites[id].file);
+        free(sites[id].func);
+        free(sites[id].fmt);
+    }
+
+    site.defined = true;
+    sites[id] = site;
+    return true;
+}
+
+/* Formats one message by walking the site's format and printing each conversion with its recorded argument */
+static bool
+print_message(FILE* out, const site_t* site, reader_t* r)
+{
+    static char str[UINT16_MAX + 1];
+    unsigned arg = 0;
+
+    for (const char* p = site->fmt; *p; ++p) {
+        if (*p != '%') {
+            fputc(*p, out);
+            continue;
+        }
+
+        if (p[1] == '%') {
+            fputc('%', out);
+            p += 1;
+            continue;
+        }
+
+        char spec[64] = "%";
+        size_t len = 1;
+        bool precision = false;
+
+        for (p += 1; *p && strchr("-+ #0123456789.*", *p); ++p) {
+            if (*p == '.')
+                precision = true;
+
+            if (*p != '*') {
+                spec[len++] = *p;
+                continue;
+            }
+
+            int64_t value;
+
+            if (arg >= site->nargs || !read_bytes(r, &value, 8))
+                return false;
+
+            arg += 1;
+
+            /* A negative precision means none was given */
+            if (precision && value < 0)
+                len -= 1;
+            else
+                len += (size_t)snprintf(spec + len, sizeof(spec) - len, "%d", (int)value);
+
+            if (len >= sizeof(spec) - 4)
+                return false;
+        }
+
+        while (*p && strchr("hlzjtL", *p) && len < sizeof(spec) - 2)
+            spec[len++] = *p++;
+
+        spec[len++] = *p;
+        spec[len] = '\0';
+
+        if (arg >= site->nargs)
+            return false;
+
+        int64_t value = 0;
+        double real = 0.0;
+
+        if (site->args[arg] == LOG_ARG_STRING) {
+            uint16_t n;
+
+            if (!read_bytes(r, &n, 2) || !read_bytes(r, str, n))
+                return false;
+
+            str[n] = '\0';
+        } else if (!read_bytes(r, site->args[arg] >= LOG_ARG_DOUBLE && site->args[arg] <= LOG_ARG_LDOUBLE ? (void*)&real : (void*)&value, 8)) {
+            return false;
+        }
+
+        switch (site->args[arg++]) {
+            case LOG_ARG_INT:     fprintf(out, spec, (int)value);                break;
+            case LOG_ARG_LONG:    fprintf(out, spec, (long)value);               break;
+            case LOG_ARG_LLONG:   fprintf(out, spec, (long long)value);          break;
+            case LOG_ARG_SIZE:    fprintf(out, spec, (size_t)value);             break;
+            case LOG_ARG_INTMAX:  fprintf(out, spec, (intmax_t)value);           break;
+            case LOG_ARG_PTRDIFF: fprintf(out, spec, (ptrdiff_t)value);          break;
+            case LOG_ARG_PTR:     fprintf(out, spec, (void*)(uintptr_t)value);   break;
+            case LOG_ARG_DOUBLE:  fprintf(out, spec, real);                      break;
+            case LOG_ARG_LDOUBLE: fprintf(out, spec, (long double)real);         break;
+            case LOG_ARG_STRING:  fprintf(out, spec, str);                       break;
+            default:              return false;
+        }
+
+        if (!*p)
+            break;
+    }
+
+    return true;
+}
+
+static bool
+decode(FILE* out, reader_t* r)
+{
+    char magic[sizeof(LOG_BINARY_MAGIC) - 1];
+
+    if (!read_bytes(r, magic, sizeof(magic)) || memcmp(magic, LOG_BINARY_MAGIC, sizeof(magic)) != 0) {
+        fprintf(stderr, "logdecode: not a binary log\n");
+        return false;
+    }
+
+    while (r->pos < r->size) {
+        unsigned char type = r->data[r->pos++];
+
+        if (type == LOG_BINARY_SITE) {
+            if (!read_site(r))
+                break;
+            continue;
+        }
+
+        uint32_t id;
+        uint16_t len;
+
+        if ((type != LOG_BINARY_MESSAGE && type != LOG_BINARY_TEXT) || !read_bytes(r, &id, 4) || !read_bytes(r, &len, 2))
+            break;
+
+        if (r->size - r->pos < len)
+            break;
+
+        reader_t payload = {r->data + r->pos, len, 0};
+        r->pos += len;
+
+        if (id >= site_count || !sites[id].defined) {
+            fprintf(out, "[logdecode] message from unknown site %u\n", id);
+            continue;
+        }
+
+        const site_t* site = &sites[id];
+
+        fprintf(out, "[%8s:%3u] [%-5s] %s(): ", site->file, site->line, level_name(site->level), site->func);
+
+        if (type == LOG_BINARY_TEXT)
+            fprintf(out, "%.*s", (int)len, (const char*)payload.data);
+        else if (!print_message(out, site, &payload))
+            fprintf(out, " [logdecode] bad arguments");
+
+        fputc('\n', out);
+    }
+
+    if (r->pos < r->size) {
+        fprintf(stderr, "logdecode: corrupt record at offset %zu\n", r->pos);
+        return false;
+    }
+
+    return true;
+}
+
+int
+main(int argc, char** argv)
+{
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <binary log>\n", argv[0]);
+        return 1;
+    }
+
+    FILE* file = fopen(argv[1], "rb");
+
+    if (!file) {
+        fprintf(stderr, "logdecode: failed to open '%s'\n", argv[1]);
+        return 1;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    unsigned char* data = size > 0 ? malloc((size_t)size) : NULL;
+
+    if (!data || fread(data, 1, (size_t)size, file) != (size_t)size) {
+        fprintf(stderr, "logdecode: failed to read '%s'\n", argv[1]);
+        fclose(file);
+        free(data);
+        return 1;
+    }
+
+    fclose(file);
+
+    reader_t reader = {data, (size_t)size, 0};
+    bool ok = decode(stdout, &reader);
+
+    for (size_t i = 0; i < site_count; ++i) {
+        free(sites[i].file);
+        free(sites[i].func);
+        free(sites[i].fmt);
+    }
+
+    free(sites);
+    free(data);
+
+    return ok ? 0 : 1;
+}
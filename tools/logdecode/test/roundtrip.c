@@ -0,0 +1,105 @@
+/*
+ * Writes messages to a binary log, decodes it with logdecode and checks that
+ * every message reads as snprintf prints the same arguments:
+ *
+ *     logdecode_roundtrip <logdecode> <binary log>
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "engine/core/log.h"
+#include "engine/core/strview.h"
+
+#define MAX_CASES 16
+#define MAX_LINE  256
+
+static char gExpected[MAX_CASES][MAX_LINE];
+static int  gCount = 0;
+
+/* Each expansion is a call site of its own */
+#define CASE(...)                                                               \
+    do {                                                                        \
+        snprintf(gExpected[gCount++], MAX_LINE, __VA_ARGS__);                   \
+        logi(__VA_ARGS__);                                                      \
+    } while (0)
+
+int
+main(int argc, char** argv)
+{
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <logdecode> <binary log>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    /* Not terminated, a view of its first 3 characters ends just before the end of the allocation */
+    char* chars = malloc(4);
+
+    if (!chars)
+        return EXIT_FAILURE;
+
+    memcpy(chars, "abcd", 4);
+    strview_t view = strview_from_n(chars, 3);
+
+    log_sink_remove(log_console());
+
+    if (!log_binary_start(argv[2]))
+        return EXIT_FAILURE;
+
+    CASE("view %.*s", STRVIEW_ARG(view));
+    CASE("literal %.3s and %.2s", chars, chars);
+    CASE("none %.0s|%s", chars, "tail");
+    CASE("negative [%.*s]", -1, "whole");
+    CASE("width [%*.*s] [%5.2s]", 6, 2, "xyz", "hello");
+    CASE("mixed %d %.*s %zu", 7, 2, chars, (size_t)42);
+
+    log_binary_stop();
+    log_sink_add(log_console());
+    free(chars);
+
+    char text[1024];
+    char command[2048];
+
+    snprintf(text, sizeof(text), "%s.txt", argv[2]);
+    snprintf(command, sizeof(command), "\"%s\" \"%s\" > \"%s\"", argv[1], argv[2], text);
+
+    if (system(command) != 0) {
+        fprintf(stderr, "failed to run %s\n", command);
+        return EXIT_FAILURE;
+    }
+
+    FILE* file = fopen(text, "r");
+
+    if (!file)
+        return EXIT_FAILURE;
+
+    char line[1024];
+    int checked = 0;
+    int failed = 0;
+
+    while (fgets(line, sizeof(line), file)) {
+        const char* msg = strstr(line, "] main(): ");
+
+        if (!msg)
+            continue;
+
+        msg += strlen("] main(): ");
+        line[strcspn(line, "\n")] = '\0';
+
+        if (checked >= gCount || strcmp(msg, gExpected[checked]) != 0) {
+            fprintf(stderr, "expected '%s', decoded '%s'\n", checked < gCount ? gExpected[checked] : "", msg);
+            failed += 1;
+        }
+
+        checked += 1;
+    }
+
+    fclose(file);
+
+    if (checked != gCount) {
+        fprintf(stderr, "decoded %d of %d messages\n", checked, gCount);
+        failed += 1;
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}